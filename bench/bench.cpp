@@ -0,0 +1,588 @@
+﻿#include "easy_json.h"
+#include "easy_json_lines.h"
+#include "easy_json_writer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Every global allocation is counted, allocations per document are the
+// difference across one parse
+static std::atomic<uint64_t> allocations(0);
+
+void * operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void * p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void * operator new(size_t size, std::align_val_t align)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t alignment = static_cast<size_t>(align);
+    size = (size + alignment - 1) / alignment * alignment;
+    if (void * p = aligned_alloc(alignment, size ? size : alignment))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void * p) noexcept { free(p); }
+void operator delete(void * p, size_t) noexcept { free(p); }
+void operator delete(void * p, std::align_val_t) noexcept { free(p); }
+void operator delete(void * p, size_t, std::align_val_t) noexcept { free(p); }
+
+namespace
+{
+    // deterministic generators, the same seed gives the same corpus everywhere
+    class Random
+    {
+    public:
+        explicit Random(uint64_t seed) : _state(seed) {}
+
+        uint64_t next()
+        {
+            _state ^= _state << 13;
+            _state ^= _state >> 7;
+            _state ^= _state << 17;
+            return _state;
+        }
+
+        int range(int lo, int hi) { return lo + static_cast<int>(next() % static_cast<uint64_t>(hi - lo + 1)); }
+        double real(double lo, double hi) { return lo + (hi - lo) * static_cast<double>(next() >> 11) / 9007199254740992.0; }
+
+    private:
+        uint64_t _state;
+    };
+
+    std::string word(Random & rng, int length)
+    {
+        std::string text;
+        for (int i = 0; i < length; ++i)
+            text.push_back(static_cast<char>('a' + rng.range(0, 25)));
+        return text;
+    }
+
+    // number heavy: polygon rings of coordinate pairs
+    std::string make_canada(size_t target)
+    {
+        Random rng(1);
+        std::string out;
+        easy_json::JsonWriter writer(out, target + 4096);
+        writer.begin_object();
+        writer.key("type");
+        writer.string("FeatureCollection");
+        writer.key("features");
+        writer.begin_array();
+        while (writer.bytes_written() < target)
+        {
+            writer.begin_object();
+            writer.key("type");
+            writer.string("Feature");
+            writer.key("properties");
+            writer.begin_object();
+            writer.key("name");
+            writer.string("Canada");
+            writer.end_object();
+            writer.key("geometry");
+            writer.begin_object();
+            writer.key("type");
+            writer.string("Polygon");
+            writer.key("coordinates");
+            writer.begin_array();
+            for (int ring = 0; ring < 8; ++ring)
+            {
+                writer.begin_array();
+                for (int point = rng.range(100, 400); point > 0; --point)
+                {
+                    writer.begin_array();
+                    writer.number(rng.real(-141.0, -52.0));
+                    writer.number(rng.real(41.0, 83.0));
+                    writer.end_array();
+                }
+                writer.end_array();
+            }
+            writer.end_array();
+            writer.end_object();
+            writer.end_object();
+        }
+        writer.end_array();
+        writer.end_object();
+        writer.flush();
+        return out;
+    }
+
+    // string heavy: status objects with unicode text, nested user / entities
+    std::string make_twitter(size_t target)
+    {
+        static const char * const fragments[] = {
+            "\xE4\xBB\x8A\xE6\x97\xA5\xE3\x81\xAF",        // CJK
+            "\xE3\x81\x8A\xE3\x81\xAF\xE3\x82\x88\xE3\x81\x86",
+            "\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82",    // cyrillic
+            "\xF0\x9F\x98\x80",                            // emoji
+            "caf\xC3\xA9", "RT @user:", "#hashtag", "https://t.co/x", "\"quoted\"", "line\nbreak",
+        };
+        Random rng(2);
+        std::string out;
+        easy_json::JsonWriter writer(out, target + 4096);
+        writer.begin_object();
+        writer.key("statuses");
+        writer.begin_array();
+        uint64_t id = 505874924095815681ull;
+        while (writer.bytes_written() < target)
+        {
+            std::string text;
+            for (int i = rng.range(4, 16); i > 0; --i)
+            {
+                text += rng.range(0, 2) == 0 ? fragments[rng.range(0, 9)] : word(rng, rng.range(2, 9));
+                text.push_back(' ');
+            }
+
+            writer.begin_object();
+            writer.key("created_at");
+            writer.string("Sun Aug 31 00:29:15 +0000 2014");
+            writer.key("id");
+            writer.unsigned_integer(id);
+            writer.key("id_str");
+            writer.string(std::to_string(id));
+            writer.key("text");
+            writer.string(text);
+            writer.key("truncated");
+            writer.boolean(false);
+            writer.key("in_reply_to_status_id");
+            writer.null();
+            writer.key("user");
+            writer.begin_object();
+            writer.key("id");
+            writer.integer(rng.range(1, 1 << 30));
+            writer.key("name");
+            writer.string(fragments[rng.range(0, 4)]);
+            writer.key("screen_name");
+            writer.string(word(rng, 10));
+            writer.key("description");
+            writer.string(text.substr(0, text.size() / 2));
+            writer.key("followers_count");
+            writer.integer(rng.range(0, 100000));
+            writer.key("verified");
+            writer.boolean(rng.range(0, 9) == 0);
+            writer.end_object();
+            writer.key("entities");
+            writer.begin_object();
+            writer.key("hashtags");
+            writer.begin_array();
+            for (int i = rng.range(0, 3); i > 0; --i)
+            {
+                writer.begin_object();
+                writer.key("text");
+                writer.string(word(rng, 6));
+                writer.key("indices");
+                writer.begin_array();
+                writer.integer(rng.range(0, 70));
+                writer.integer(rng.range(70, 140));
+                writer.end_array();
+                writer.end_object();
+            }
+            writer.end_array();
+            writer.end_object();
+            writer.key("retweet_count");
+            writer.integer(rng.range(0, 5000));
+            writer.key("lang");
+            writer.string("ja");
+            writer.end_object();
+            id += rng.range(1, 1000);
+        }
+        writer.end_array();
+        writer.end_object();
+        writer.flush();
+        return out;
+    }
+
+    // deeply nested objects and arrays, depth 200 per branch
+    std::string make_nested(size_t target)
+    {
+        Random rng(3);
+        std::string out;
+        easy_json::JsonWriter writer(out, target + 4096);
+        writer.begin_array();
+        while (writer.bytes_written() < target)
+        {
+            const int depth = 200;
+            for (int i = 0; i < depth; ++i)
+            {
+                if (i % 2 == 0)
+                {
+                    writer.begin_object();
+                    writer.key(i % 4 == 0 ? "child" : "next");
+                }
+                else
+                {
+                    writer.begin_array();
+                    writer.integer(rng.range(0, 1000));
+                }
+            }
+            writer.string(word(rng, 8));
+            for (int i = depth - 1; i >= 0; --i)
+            {
+                if (i % 2 == 0)
+                    writer.end_object();
+                else
+                    writer.end_array();
+            }
+        }
+        writer.end_array();
+        writer.flush();
+        return out;
+    }
+
+    // one object with many distinct keys
+    std::string make_wide(size_t target)
+    {
+        Random rng(4);
+        std::string out;
+        easy_json::JsonWriter writer(out, target + 4096);
+        writer.begin_object();
+        for (int i = 0; writer.bytes_written() < target; ++i)
+        {
+            writer.key("field_" + std::to_string(i) + "_" + word(rng, 4));
+            switch (i % 4)
+            {
+            case 0:
+                writer.integer(rng.range(-100000, 100000));
+                break;
+            case 1:
+                writer.string(word(rng, rng.range(3, 20)));
+                break;
+            case 2:
+                writer.number(rng.real(-1.0, 1.0));
+                break;
+            default:
+                writer.boolean(i % 8 == 3);
+                break;
+            }
+        }
+        writer.end_object();
+        writer.flush();
+        return out;
+    }
+
+    // one line of the JSON Lines corpus, the writer trims out to its own
+    // length when destroyed so the newline is appended after it is gone
+    void write_record(std::string & out, Random & rng, int i)
+    {
+        easy_json::JsonWriter writer(out, 0);
+        writer.begin_object();
+        writer.key("seq");
+        writer.integer(i);
+        writer.key("ts");
+        writer.unsigned_integer(1700000000000ull + static_cast<uint64_t>(i) * 17);
+        writer.key("level");
+        writer.string(rng.range(0, 3) == 0 ? "warn" : "info");
+        writer.key("message");
+        writer.string(word(rng, rng.range(10, 60)));
+        writer.key("latency");
+        writer.number(rng.real(0.0, 250.0));
+        writer.key("tags");
+        writer.begin_array();
+        for (int t = rng.range(0, 4); t > 0; --t)
+            writer.string(word(rng, 5));
+        writer.end_array();
+        writer.end_object();
+        writer.flush();
+    }
+
+    // JSON Lines: small flat records, one per line
+    std::string make_ndjson(size_t target)
+    {
+        Random rng(5);
+        std::string out;
+        out.reserve(target + 4096);
+        for (int i = 0; out.size() < target; ++i)
+        {
+            write_record(out, rng, i);
+            out.push_back('\n');
+        }
+        return out;
+    }
+
+    struct Options
+    {
+        size_t size = 4 << 20;          // bytes per generated corpus
+        double min_time = 0.2;          // seconds spent per measurement
+        const char * filter = nullptr;  // only corpora whose name contains this
+        bool json = false;
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    // best time of one run in seconds, runs are repeated until min_time passed.
+    // setup is untimed and prepares each run.
+    double measure(const Options & options, const std::function<void()> & setup, const std::function<void()> & run)
+    {
+        double best = 1e30;
+        double total = 0.0;
+        int runs = 0;
+        while (runs < 3 || total < options.min_time)
+        {
+            setup();
+            auto start = Clock::now();
+            run();
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            best = std::min(best, seconds);
+            total += seconds;
+            ++runs;
+        }
+        return best;
+    }
+
+    double measure(const Options & options, const std::function<void()> & run)
+    {
+        return measure(options, [] {}, run);
+    }
+
+    double mbps(size_t bytes, double seconds)
+    {
+        return seconds > 0.0 ? static_cast<double>(bytes) / seconds / 1e6 : 0.0;
+    }
+
+    // every (object, key) pair of the tree, in document order
+    void collect_keys(const easy_json::JsonAny * value, std::vector<std::pair<const easy_json::JsonObject *, std::string_view>> & keys)
+    {
+        if (const auto * obj = value->to_object())
+        {
+            for (size_t i = 0; i < obj->count(); ++i)
+            {
+                keys.emplace_back(obj, obj->key_view_at(static_cast<int>(i)));
+                collect_keys(obj->value_at(static_cast<int>(i)), keys);
+            }
+        }
+        else if (const auto * arr = value->to_array())
+        {
+            for (size_t i = 0; i < arr->count(); ++i)
+                collect_keys(arr->at(static_cast<int>(i)), keys);
+        }
+    }
+
+    struct Result
+    {
+        std::string corpus;
+        size_t bytes = 0;
+        double parse = 0.0;         // MB/s into a JsonDocument
+        double parse_borrow = 0.0;  // same with JSON_PARSE_BORROW_INPUT
+        double parse_heap = 0.0;    // JsonAny::parse
+        double dump = 0.0;
+        double lookup = 0.0;        // every key of the document looked up once
+        double lookup_ns = 0.0;     // per lookup
+        double free = 0.0;          // JsonAny::destroy of the heap tree
+        double allocs = 0.0;        // per JsonDocument parse
+        double reuse_allocs = 0.0;  // per parse into a warm JsonDocument
+        double heap_allocs = 0.0;   // per JsonAny::parse
+        double arena_kb = 0.0;      // document memory in use after a parse
+        double intern_kb = 0.0;     // same with interned keys
+        bool ok = true;
+    };
+
+    Result bench_document(const Options & options, const std::string & name, const std::string & text)
+    {
+        Result result;
+        result.corpus = name;
+        result.bytes = text.size();
+
+        easy_json::JsonDocument doc;
+        result.parse = mbps(text.size(), measure(options, [&] { result.ok &= doc.parse(text); }));
+        result.parse_borrow = mbps(text.size(), measure(options, [&] { result.ok &= doc.parse(text, easy_json::JSON_PARSE_BORROW_INPUT); }));
+
+        easy_json::JsonAny * heap = nullptr;
+        result.parse_heap = mbps(text.size(), measure(options, [&] { easy_json::JsonAny::destroy(heap); heap = nullptr; },
+                                                      [&] { heap = easy_json::JsonAny::parse(text); }));
+        result.ok &= heap != nullptr;
+        result.free = mbps(text.size(), measure(options, [&] { if (!heap) heap = easy_json::JsonAny::parse(text); },
+                                                [&] { easy_json::JsonAny::destroy(heap); heap = nullptr; }));
+
+        std::string out;
+        result.ok &= doc.parse(text);
+        result.dump = mbps(text.size(), measure(options, [&] { out = doc.root()->dump(); }));
+
+        std::vector<std::pair<const easy_json::JsonObject *, std::string_view>> keys;
+        collect_keys(doc.root(), keys);
+        size_t found = 0;
+        double seconds = measure(options, [&] {
+            for (const auto & entry : keys)
+                found += entry.first->get_property(entry.second) != nullptr;
+        });
+        result.ok &= found % keys.size() == 0;
+        result.lookup = mbps(text.size(), seconds);
+        result.lookup_ns = keys.empty() ? 0.0 : seconds * 1e9 / static_cast<double>(keys.size());
+
+        {
+            easy_json::JsonDocument fresh;
+            uint64_t before = allocations.load();
+            result.ok &= fresh.parse(text);
+            result.allocs = static_cast<double>(allocations.load() - before);
+        }
+        {
+            // lookups made nodes for packed arrays, one parse merges the grown arena
+            result.ok &= doc.parse(text);
+            uint64_t before = allocations.load();
+            result.ok &= doc.parse(text);
+            result.reuse_allocs = static_cast<double>(allocations.load() - before);
+            result.arena_kb = static_cast<double>(doc.arena().bytes_used()) / 1024.0;
+
+            easy_json::JsonDocument interned;
+            interned.set_intern_keys(true);
+            result.ok &= interned.parse(text);
+            result.intern_kb = static_cast<double>(interned.arena().bytes_used()) / 1024.0;
+        }
+        uint64_t before = allocations.load();
+        heap = easy_json::JsonAny::parse(text);
+        result.heap_allocs = static_cast<double>(allocations.load() - before);
+        easy_json::JsonAny::destroy(heap);
+        return result;
+    }
+
+    // one document per line, dump / lookup / free do not apply
+    Result bench_lines(const Options & options, const std::string & name, const std::string & text, unsigned threads)
+    {
+        Result result;
+        result.corpus = name;
+        result.bytes = text.size();
+
+        easy_json::JsonLinesParser::Options lines_options;
+        lines_options.threads = threads;
+        easy_json::JsonLinesParser parser(lines_options);
+        auto ignore = [](const easy_json::JsonLinesParser::Record &, easy_json::JsonDocument *) {};
+        result.parse = mbps(text.size(), measure(options, [&] { result.ok &= parser.parse(text.data(), text.size(), ignore); }));
+
+        lines_options.flags = easy_json::JSON_PARSE_BORROW_INPUT;
+        easy_json::JsonLinesParser borrow(lines_options);
+        result.parse_borrow = mbps(text.size(), measure(options, [&] { result.ok &= borrow.parse(text.data(), text.size(), ignore); }));
+
+        result.ok &= parser.failures() == 0 && parser.lines() > 1;
+        if (threads == 1)
+        {
+            uint64_t before = allocations.load();
+            result.ok &= parser.parse(text.data(), text.size(), ignore);
+            result.allocs = static_cast<double>(allocations.load() - before) / static_cast<double>(std::max<size_t>(parser.lines(), 1));
+        }
+        return result;
+    }
+
+    void print_text(const std::vector<Result> & results)
+    {
+        printf("%-12s %9s %9s %9s %9s %9s %9s %9s %9s %10s %10s %10s %10s %10s\n", "corpus", "KB", "parse", "borrow", "heap",
+               "dump", "lookup", "ns/key", "free", "allocs", "reuse", "heap_alloc", "arena_KB", "intern_KB");
+        for (const auto & r : results)
+        {
+            printf("%-12s %9zu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %10.1f %10.1f %10.1f %10.1f %10.1f%s\n", r.corpus.c_str(),
+                   r.bytes / 1024, r.parse, r.parse_borrow, r.parse_heap, r.dump, r.lookup, r.lookup_ns, r.free, r.allocs,
+                   r.reuse_allocs, r.heap_allocs, r.arena_kb, r.intern_kb, r.ok ? "" : "  FAILED");
+        }
+        printf("throughput in MB/s, allocations per document\n");
+    }
+
+    void print_json(const std::vector<Result> & results)
+    {
+        std::string out;
+        easy_json::JsonWriter writer(out);
+        writer.begin_object();
+        writer.key("schema");
+        writer.integer(1);
+        writer.key("results");
+        writer.begin_array();
+        for (const auto & r : results)
+        {
+            writer.begin_object();
+            writer.key("corpus");
+            writer.string(r.corpus);
+            writer.key("bytes");
+            writer.unsigned_integer(r.bytes);
+            writer.key("ok");
+            writer.boolean(r.ok);
+            const std::pair<const char *, double> metrics[] = {
+                { "parse_mbps", r.parse }, { "parse_borrow_mbps", r.parse_borrow }, { "parse_heap_mbps", r.parse_heap },
+                { "dump_mbps", r.dump }, { "lookup_mbps", r.lookup }, { "lookup_ns", r.lookup_ns },
+                { "free_mbps", r.free }, { "allocs_per_doc", r.allocs }, { "reuse_allocs_per_doc", r.reuse_allocs },
+                { "heap_allocs_per_doc", r.heap_allocs }, { "arena_kb", r.arena_kb }, { "intern_arena_kb", r.intern_kb },
+            };
+            for (const auto & metric : metrics)
+            {
+                writer.key(metric.first);
+                writer.number(metric.second);
+            }
+            writer.end_object();
+        }
+        writer.end_array();
+        writer.end_object();
+        writer.flush();
+        printf("%s\n", out.c_str());
+    }
+
+    void usage()
+    {
+        printf("usage: easy_json_bench [--json] [--size BYTES] [--time SECONDS] [--filter NAME]\n");
+    }
+} // namespace
+
+int main(int argc, char ** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--json") == 0)
+            options.json = true;
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            options.size = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc)
+            options.min_time = strtod(argv[++i], nullptr);
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            options.filter = argv[++i];
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    struct Corpus
+    {
+        const char * name;
+        std::string (*make)(size_t);
+    };
+    static const Corpus corpora[] = {
+        { "canada", make_canada },
+        { "twitter", make_twitter },
+        { "nested", make_nested },
+        { "wide", make_wide },
+    };
+
+    std::vector<Result> results;
+    auto selected = [&](const char * name) { return options.filter == nullptr || strstr(name, options.filter) != nullptr; };
+    for (const auto & corpus : corpora)
+    {
+        if (selected(corpus.name))
+            results.push_back(bench_document(options, corpus.name, corpus.make(options.size)));
+    }
+    if (selected("ndjson"))
+    {
+        std::string text = make_ndjson(options.size);
+        results.push_back(bench_lines(options, "ndjson", text, 1));
+        results.push_back(bench_lines(options, "ndjson_mt", text, 0));
+    }
+
+    if (options.json)
+        print_json(results);
+    else
+        print_text(results);
+
+    bool ok = std::all_of(results.begin(), results.end(), [](const Result & r) { return r.ok; });
+    return ok ? 0 : 1;
+}
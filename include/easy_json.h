@@ -1,82 +1,512 @@
 ﻿#pragma once
+#include <cstddef>
+#include <cstdint>
 #include <deque>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace easy_json {
     class JsonArray;
     class JsonObject;
+    class JsonDocument;
+    class JsonKey;
+    class JsonSink;
+    class JsonMappedFile;
 
+    // Bump pointer arena. Memory is carved from blocks requested from the
+    // upstream resource and only given back by release() / destruction.
+    class JsonArena : public std::pmr::memory_resource
+    {
+    public:
+        explicit JsonArena(std::pmr::memory_resource * upstream = std::pmr::get_default_resource(),
+                           size_t initial_block_size = 4096);
+        virtual ~JsonArena() override;
+
+        JsonArena(const JsonArena &) = delete;
+        JsonArena & operator=(const JsonArena &) = delete;
+
+        void release();
+        // forgets every allocation but keeps the memory for reuse
+        void reset();
+        size_t bytes_used() const { return _used; }
+        size_t bytes_reserved() const { return _reserved; }
+        // blocks / bytes requested from upstream since construction
+        size_t allocations() const { return _allocations; }
+        size_t bytes_allocated() const { return _allocated; }
+        std::pmr::memory_resource * upstream() const { return _upstream; }
+
+        // pooled upstream owned by the calling thread, blocks are recycled
+        // between documents created and destroyed on that thread
+        static std::pmr::memory_resource * thread_local_pool();
+
+    protected:
+        virtual void * do_allocate(size_t bytes, size_t alignment) override;
+        virtual void do_deallocate(void *, size_t, size_t) override {}
+        virtual bool do_is_equal(const std::pmr::memory_resource & other) const noexcept override
+        {
+            return this == &other;
+        }
+
+    private:
+        struct Block
+        {
+            Block * next;
+            size_t size;
+        };
+
+        void add_block(size_t size);
+
+        std::pmr::memory_resource * _upstream = nullptr;
+        Block * _blocks = nullptr;
+        char * _cur = nullptr;
+        char * _end = nullptr;
+        size_t _initial_block_size = 0;
+        size_t _next_block_size = 0;
+        size_t _used = 0;
+        size_t _reserved = 0;
+        size_t _allocations = 0;
+        size_t _allocated = 0;
+    };
+
+    enum class JsonType : uint8_t
+    {
+        Null,
+        Boolean,
+        Number,
+        String,
+        Object,
+        Array,
+    };
+
+    // representation of a JsonType::Number value
+    enum class JsonNumberType : uint8_t
+    {
+        Double,
+        Int64,
+        Uint64,
+        Raw,    // source text kept verbatim, converted on access
+    };
+
+    struct JsonObjectStorage;
+    struct JsonArrayStorage;
+    class JsonDomBuilder;
+
+    enum JsonParseFlag : uint32_t
+    {
+        JSON_PARSE_DEFAULT = 0,
+        // strings and keys reference the input instead of being copied, the
+        // input must outlive the document. Escaped strings are still copied once.
+        JSON_PARSE_BORROW_INPUT = 0x01,
+        // numbers keep their source text, for values beyond double / 64 bit precision
+        JSON_PARSE_RAW_NUMBERS = 0x02,
+        // two stage parse: a SIMD pass indexes the structural characters and
+        // the parser jumps between those positions instead of scanning blanks.
+        // Same result, pays off on pretty printed / whitespace heavy input.
+        JSON_PARSE_STRUCTURAL_INDEX = 0x04,
+    };
+
+    enum JsonParseError : int
+    {
+        JSON_ERROR_NONE = 0,
+        JSON_ERROR_SYNTAX = -1,
+        JSON_ERROR_HANDLER = -2,            // a handler callback returned false
+        JSON_ERROR_DEPTH = -3,              // JsonParseLimits exceeded
+        JSON_ERROR_DOCUMENT_SIZE = -4,
+        JSON_ERROR_STRING_LENGTH = -5,
+        JSON_ERROR_NODE_COUNT = -6,
+        JSON_ERROR_FILE = -7,               // the input file could not be read
+    };
+
+    const char * json_error_message(int error);
+
+    // Bounds for untrusted input, checked while reading so an oversized or
+    // hostile document fails with a JsonParseError instead of exhausting
+    // memory. Trees are released and written recursively, hence the default depth.
+    struct JsonParseLimits
+    {
+        uint32_t max_depth = 1024;
+        size_t max_document_size = SIZE_MAX;
+        size_t max_string_length = SIZE_MAX;    // decoded bytes, keys included
+        size_t max_nodes = SIZE_MAX;            // values of any type
+    };
+
+    // 16 byte tagged value: type tag, flags and string length in the first
+    // word, scalars inline and strings / containers out of line in the second.
+    // JsonObject and JsonArray are views over the same layout, so type checks
+    // and scalar reads are a single compare.
     class JsonAny
     {
     protected:
+        enum : uint8_t
+        {
+            FLAG_IN_DOCUMENT = 0x01,    // payload belongs to a JsonDocument arena
+            FLAG_ADOPTED = 0x02,        // heap node owned by the JsonDocument it was attached to
+        };
+
         JsonAny() = default;
+        explicit JsonAny(JsonType type) : _type(type) {}
+
+        JsonType _type = JsonType::Null;
+        uint8_t _flags = 0;
+        JsonNumberType _number_type = JsonNumberType::Double;
+        uint8_t _reserved = 0;
+        uint32_t _size = 0;    // string / raw number length
+        union
+        {
+            bool b;
+            double d;
+            int64_t i;
+            uint64_t u;
+            char * s;
+            JsonObjectStorage * o;
+            JsonArrayStorage * a;
+        } _v = {};
 
     public:
-        virtual ~JsonAny() = default;
-
-        bool is_string();
-        bool is_boolean();
-        bool is_number();
-        bool is_object();
-        bool is_array();
-        bool is_null();
-
-        std::string to_str();
-        bool to_boolean();
-        int64_t to_integer();
-        double to_number();
+        ~JsonAny();
+
+        JsonAny(const JsonAny &) = delete;
+        JsonAny & operator=(const JsonAny &) = delete;
+
+        JsonType type() const { return _type; }
+        bool in_document() const { return (_flags & FLAG_IN_DOCUMENT) != 0; }
+
+        bool is_string() const { return _type == JsonType::String; }
+        bool is_boolean() const { return _type == JsonType::Boolean; }
+        bool is_number() const { return _type == JsonType::Number; }
+        bool is_object() const { return _type == JsonType::Object; }
+        bool is_array() const { return _type == JsonType::Array; }
+        bool is_null() const { return _type == JsonType::Null; }
+
+        std::string to_str() const { return std::string(str_view()); }
+        std::string_view str_view() const { return is_string() ? std::string_view(_v.s, _size) : std::string_view(); }
+        bool to_boolean() const { return is_boolean() && _v.b; }
+        int64_t to_integer() const;
+        uint64_t to_unsigned() const;
+        double to_number() const;
+        JsonNumberType number_type() const { return _number_type; }
+        // true for numbers stored exactly as int64 / uint64
+        bool is_integer() const { return is_number() && (_number_type == JsonNumberType::Int64 || _number_type == JsonNumberType::Uint64); }
+        // source text of JsonNumberType::Raw numbers
+        std::string_view number_text() const { return is_number() && _number_type == JsonNumberType::Raw ? std::string_view(_v.s, _size) : std::string_view(); }
         JsonObject * to_object();
+        const JsonObject * to_object() const;
         JsonArray * to_array();
+        const JsonArray * to_array() const;
 
-        virtual std::string dump() = 0;
+        std::string dump() const;
+        bool dump(JsonSink & sink) const;
+        // deep comparison, member order is ignored and numbers compare by value
+        bool equals(const JsonAny * other) const;
+        // MessagePack encoding, see easy_json_msgpack.h
+        std::string dump_msgpack() const;
+        void dump_msgpack(std::string & out) const;
 
     public:
         static JsonAny * str(const char * value = nullptr);
         static JsonAny * str(const char * value, int length);
         static JsonAny * boolean(bool value = false);
         static JsonAny * integer(int64_t value = 0);
+        static JsonAny * unsigned_integer(uint64_t value = 0);
         static JsonAny * number(double value = 0.0);
+        // keeps text verbatim, it must be a valid JSON number
+        static JsonAny * raw_number(const char * text, int length);
         static JsonAny * null();
         static JsonObject * object();
         static JsonArray * array();
 
         static JsonAny * parse(const char * str);
+        static JsonAny * parse(const char * str, size_t length);
+        static JsonAny * parse(std::string_view str);
         static JsonAny * parse_file(const char * str);
+        static JsonAny * parse_msgpack(const char * data, size_t length);
+
+        // deletes nodes created by the factories above, nodes owned by a
+        // JsonDocument, attached ones included, are left to the document
+        static void destroy(JsonAny * value);
+
+    private:
+        friend class JsonDocument;
+        friend class JsonDomBuilder;
+        double raw_to_number() const;
+        int64_t raw_to_integer() const;
     };
 
     class JsonObject : public JsonAny
     {
-
     public:
-        virtual ~JsonObject() override;
-
         size_t count() const;
         std::string key_at(int index) const;
+        std::string_view key_view_at(int index) const;
         JsonAny * value_at(int index) const;
-        virtual std::string dump() override;
 
         JsonObject * set_property(const char * key, JsonAny * value);
+        JsonObject * set_property(std::string_view key, JsonAny * value);
         JsonAny * get_property(const char * key) const;
+        JsonAny * get_property(std::string_view key) const;
+        // lookup with a hash precomputed by hash_key()
+        JsonAny * get_property(std::string_view key, uint32_t hash) const;
+        // lookup of a key interned by a JsonDocument, a pointer compare for
+        // objects of that document whose keys are all interned
+        JsonAny * get_property(const JsonKey & key) const;
+
+        static uint32_t hash_key(std::string_view key);
 
     private:
         friend class JsonAny;
-        typedef std::pair<std::string, JsonAny *> JsonObjectPropertyType;
-        std::deque<JsonObjectPropertyType> properties;    // keep order
-        JsonObject();
+        friend class JsonDocument;
+        friend class JsonDomBuilder;
+        // arena node of document, heap objects come from JsonAny::object()
+        explicit JsonObject(JsonDocument * document);
+        JsonObject * put_property(std::string_view key, JsonAny * value, bool copy_key);
+    };
+
+    // Object key stored once in the key table of a JsonDocument, see
+    // JsonDocument::set_intern_keys(). Valid until the document is reset.
+    class JsonKey
+    {
+    public:
+        JsonKey() = default;
+
+        bool valid() const { return _data != nullptr; }
+        std::string_view view() const { return std::string_view(_data, _length); }
+        uint32_t hash() const { return _hash; }
+        const JsonDocument * document() const { return _document; }
+
+    private:
+        friend class JsonDocument;
+        JsonKey(const JsonDocument * document, const char * data, uint32_t length, uint32_t hash)
+            : _document(document), _data(data), _length(length), _hash(hash)
+        {
+        }
+
+        const JsonDocument * _document = nullptr;
+        const char * _data = nullptr;
+        uint32_t _length = 0;
+        uint32_t _hash = 0;
+    };
+
+    // Numbers of one type stored back to back, Double or Int64. Empty when
+    // the values are not stored that way.
+    struct JsonColumn
+    {
+        JsonNumberType type = JsonNumberType::Double;
+        const void * data = nullptr;
+        size_t size = 0;
+
+        bool valid() const { return data != nullptr; }
+        const double * doubles() const { return type == JsonNumberType::Double ? static_cast<const double *>(data) : nullptr; }
+        const int64_t * integers() const { return type == JsonNumberType::Int64 ? static_cast<const int64_t *>(data) : nullptr; }
     };
 
     class JsonArray : public JsonAny
     {
     public:
-        virtual ~JsonArray();
         size_t count() const;
+        // elements of packed arrays become nodes the first time one is read
         JsonAny * at(int index) const;
         JsonArray * add(JsonAny * value);
-        virtual std::string dump() override;
+
+        // Document arrays holding only doubles or only int64 numbers are
+        // packed by the parser into one column. add() unpacks them.
+        bool packed() const;
+        JsonColumn column() const;
+        // numbers of field key across a document array of objects sharing one
+        // key sequence, built on first use and again after the rows change.
+        // Empty unless every row holds a number of the same type there.
+        JsonColumn column(std::string_view key) const;
 
     private:
         friend class JsonAny;
-        std::deque<JsonAny *> properties;
-        JsonArray();
+        friend class JsonDocument;
+        friend class JsonDomBuilder;
+        // arena node of document, heap arrays come from JsonAny::array()
+        explicit JsonArray(JsonDocument * document);
+        void pack(JsonNumberType type, const uint64_t * values, size_t count);
+    };
+
+    static_assert(sizeof(JsonAny) == 16, "JsonAny must stay a 16 byte value");
+    static_assert(sizeof(JsonObject) == sizeof(JsonAny) && sizeof(JsonArray) == sizeof(JsonAny),
+                  "containers are views over JsonAny and must not add members");
+
+    inline double JsonAny::to_number() const
+    {
+        if (!is_number())
+            return 0.0;
+        switch (_number_type)
+        {
+        case JsonNumberType::Int64:
+            return static_cast<double>(_v.i);
+        case JsonNumberType::Uint64:
+            return static_cast<double>(_v.u);
+        case JsonNumberType::Raw:
+            return raw_to_number();
+        default:
+            return _v.d;
+        }
+    }
+
+    inline int64_t JsonAny::to_integer() const
+    {
+        if (is_number() && _number_type == JsonNumberType::Int64)
+            return _v.i;
+        if (is_number() && _number_type == JsonNumberType::Uint64)
+            return static_cast<int64_t>(_v.u);
+        if (is_number() && _number_type == JsonNumberType::Raw)
+            return raw_to_integer();
+        return static_cast<int64_t>(to_number());
+    }
+
+    inline uint64_t JsonAny::to_unsigned() const
+    {
+        if (is_number() && _number_type == JsonNumberType::Uint64)
+            return _v.u;
+        return static_cast<uint64_t>(to_integer());
+    }
+
+    inline JsonObject * JsonAny::to_object() { return is_object() ? static_cast<JsonObject *>(this) : nullptr; }
+    inline const JsonObject * JsonAny::to_object() const { return is_object() ? static_cast<const JsonObject *>(this) : nullptr; }
+    inline JsonArray * JsonAny::to_array() { return is_array() ? static_cast<JsonArray *>(this) : nullptr; }
+    inline const JsonArray * JsonAny::to_array() const { return is_array() ? static_cast<const JsonArray *>(this) : nullptr; }
+
+    // Owns an arena that every node, string and container of the document is
+    // carved from, the whole tree is freed at once when the document is
+    // cleared or destroyed. Nodes created by the JsonAny factories may still be
+    // attached to document containers: the document owns them from then on,
+    // also once replaced, and deletes them on reset / clear. A frozen document
+    // ignores the attach and deletes such a node right away.
+    // A frozen document is read-only and may be read from any number of
+    // threads, see freeze() and easy_json_shared.h.
+    class JsonDocument
+    {
+    public:
+        explicit JsonDocument(std::pmr::memory_resource * upstream = std::pmr::get_default_resource(),
+                              size_t initial_block_size = 4096);
+        ~JsonDocument();
+
+        JsonDocument(const JsonDocument &) = delete;
+        JsonDocument & operator=(const JsonDocument &) = delete;
+
+        bool parse(const char * str);
+        bool parse(const char * str, size_t length, uint32_t flags = JSON_PARSE_DEFAULT);
+        bool parse(std::string_view str, uint32_t flags = JSON_PARSE_DEFAULT) { return parse(str.data(), str.size(), flags); }
+        // parses buffer in place: escaped strings are decoded inside it and all
+        // strings reference it, so it must stay alive and untouched with the document
+        bool parse_in_situ(char * buffer, size_t length);
+        // the file is memory mapped, with JSON_PARSE_BORROW_INPUT the mapping
+        // is kept until the document is cleared
+        bool parse_file(const char * path, uint32_t flags = JSON_PARSE_DEFAULT);
+        // MessagePack input, JSON_PARSE_BORROW_INPUT makes strings reference
+        // data and JSON_PARSE_RAW_NUMBERS is ignored
+        bool parse_msgpack(const char * data, size_t length, uint32_t flags = JSON_PARSE_DEFAULT);
+
+        JsonAny * root() const { return _root; }
+        void set_root(JsonAny * value);
+        // drops the tree but keeps the arena memory and the parse buffers for
+        // the next one, O(1) unless heap nodes were attached. Parses start with it.
+        void reset();
+        // drops the tree and releases all memory
+        void clear();
+        // memory requests made for this document: arena blocks plus growth of
+        // the parse buffers and key table. Unchanged by further parses once the document is warm.
+        size_t allocations() const { return _arena.allocations() + _parse_allocations; }
+
+        // Builds every object index up front and makes the document read-only:
+        // its containers and root ignore changes from then on, so concurrent
+        // readers never race with a lookup. reset() / clear() / parse() thaw it.
+        void freeze();
+        bool frozen() const { return _frozen; }
+        // value, a node of the frozen document source, for use in this
+        // document's containers without copying it. source is kept alive by
+        // this document until it is cleared.
+        JsonAny * share(std::shared_ptr<const JsonDocument> source, const JsonAny * value);
+
+        // limits applied to the text parses of this document
+        void set_limits(const JsonParseLimits & limits) { _limits = limits; }
+        const JsonParseLimits & limits() const { return _limits; }
+        // JsonParseError of the last parse and the input offset it stopped at
+        int error() const { return _error; }
+        size_t error_offset() const { return _error_offset; }
+
+        // Object keys added while enabled are stored once per document and
+        // shared by every object holding them, so repeated record keys cost
+        // one copy and JsonKey lookups compare pointers. The table is emptied
+        // with the tree and keeps its capacity for the next parse.
+        void set_intern_keys(bool enable) { _intern_keys = enable; }
+        bool intern_keys() const { return _intern_keys; }
+        // key from the table, added if missing unless the document is frozen
+        JsonKey intern_key(std::string_view key);
+        // key from the table or an invalid key, which matches no property
+        JsonKey find_key(std::string_view key) const;
+        size_t interned_keys() const { return _key_count; }
+
+        JsonArena & arena() { return _arena; }
+
+        JsonAny * str(const char * value = nullptr);
+        JsonAny * str(const char * value, int length);
+        JsonAny * boolean(bool value = false);
+        JsonAny * integer(int64_t value = 0);
+        JsonAny * unsigned_integer(uint64_t value = 0);
+        JsonAny * number(double value = 0.0);
+        JsonAny * raw_number(const char * text, int length);
+        JsonAny * null();
+        JsonObject * object();
+        JsonArray * array();
+
+    private:
+        friend class JsonObject;
+        friend class JsonArray;
+        friend class JsonDomBuilder;
+        friend struct JsonArrayStorage;
+        struct ParseCache;
+        ParseCache & parse_cache();
+        void drop_tree();
+        bool adopt(JsonAny * node);
+        bool finish_parse(bool ok, JsonDomBuilder & builder);
+        template <typename Reader>
+        bool run_parse(Reader & reader, JsonDomBuilder & builder, uint64_t map_ns = 0);
+        // string / raw number nodes referencing memory the document does not own
+        JsonAny * str_ref(std::string_view value);
+        JsonAny * raw_number_ref(std::string_view text);
+
+        template <typename T>
+        T * create(JsonType type);
+        char * copy_string(const char * value, size_t length);
+        // count contiguous number nodes over the values of a packed array
+        JsonAny * number_nodes(JsonNumberType type, const void * values, size_t count);
+
+        // open addressing key table, slots of an older generation are empty
+        // so dropping the tree empties it in O(1)
+        struct KeySlot
+        {
+            const char * key;
+            uint32_t length;
+            uint32_t hash;
+            uint32_t generation;
+        };
+        JsonKey intern(std::string_view key, bool stable);
+        size_t key_slot(std::string_view key, uint32_t hash) const;
+        void grow_keys();
+        void drop_keys();
+
+        JsonArena _arena;
+        JsonAny * _root = nullptr;
+        std::pmr::deque<JsonAny *> _adopted;
+        std::unique_ptr<JsonMappedFile> _source;    // input the document points into
+        JsonParseLimits _limits;
+        int _error = JSON_ERROR_NONE;
+        size_t _error_offset = 0;
+        bool _frozen = false;
+        std::vector<std::shared_ptr<const JsonDocument>> _shared;    // sources of shared subtrees
+        std::unique_ptr<ParseCache> _parse_cache;    // reader and builder reused by parses
+        size_t _parse_allocations = 0;
+        bool _intern_keys = false;
+        std::vector<KeySlot> _keys;
+        size_t _key_count = 0;
+        uint32_t _key_generation = 1;
+        uint32_t _epoch = 0;    // bumped by container writes, outdates array columns
     };
 } // namespace easy_json
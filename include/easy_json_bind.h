@@ -0,0 +1,793 @@
+﻿#pragma once
+#include "easy_json_reader.h"
+#include "easy_json_writer.h"
+
+#include <array>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Binding of C++ types to JSON without an intermediate tree.
+//
+//     struct Point { int x; int y; std::optional<std::string> label; };
+//     EASY_JSON_BIND(Point, x, y, label)
+//
+//     enum class Color { Red, Green };
+//     EASY_JSON_BIND_ENUM(Color, Red, Green)
+//
+//     Point p;
+//     easy_json::from_json(text, p);
+//     std::string text = easy_json::to_json(p);
+//
+// Both macros go in the namespace of the type, at namespace scope. Missing
+// members keep their value, unknown members are skipped, empty optionals are
+// left out when writing. Unregistered enums are read and written as numbers.
+
+#define EASY_JSON_EXPAND(x) x
+#define EASY_JSON_FE_1(m, t, x) m(t, x)
+#define EASY_JSON_FE_2(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_1(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_3(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_2(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_4(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_3(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_5(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_4(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_6(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_5(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_7(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_6(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_8(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_7(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_9(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_8(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_10(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_9(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_11(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_10(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_12(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_11(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_13(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_12(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_14(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_13(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_15(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_14(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_16(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_15(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_17(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_16(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_18(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_17(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_19(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_18(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_20(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_19(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_21(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_20(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_22(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_21(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_23(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_22(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_24(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_23(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_25(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_24(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_26(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_25(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_27(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_26(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_28(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_27(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_29(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_28(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_30(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_29(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_31(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_30(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_32(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_31(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_33(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_32(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_34(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_33(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_35(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_34(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_36(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_35(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_37(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_36(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_38(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_37(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_39(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_38(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_40(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_39(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_41(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_40(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_42(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_41(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_43(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_42(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_44(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_43(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_45(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_44(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_46(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_45(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_47(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_46(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_48(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_47(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_49(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_48(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_50(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_49(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_51(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_50(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_52(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_51(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_53(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_52(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_54(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_53(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_55(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_54(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_56(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_55(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_57(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_56(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_58(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_57(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_59(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_58(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_60(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_59(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_61(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_60(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_62(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_61(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_63(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_62(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_64(m, t, x, ...) m(t, x), EASY_JSON_EXPAND(EASY_JSON_FE_63(m, t, __VA_ARGS__))
+#define EASY_JSON_FE_PICK( \
+    _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, \
+    _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, \
+    _33, _34, _35, _36, _37, _38, _39, _40, _41, _42, _43, _44, _45, _46, _47, _48, \
+    _49, _50, _51, _52, _53, _54, _55, _56, _57, _58, _59, _60, _61, _62, _63, _64, \
+    name, ...) name
+// applies m(t, x) to every x, comma separated, up to 64 arguments
+#define EASY_JSON_FOR_EACH(m, t, ...) \
+    EASY_JSON_EXPAND(EASY_JSON_FE_PICK(__VA_ARGS__, \
+    EASY_JSON_FE_64, EASY_JSON_FE_63, EASY_JSON_FE_62, EASY_JSON_FE_61, EASY_JSON_FE_60, EASY_JSON_FE_59, EASY_JSON_FE_58, EASY_JSON_FE_57, \
+    EASY_JSON_FE_56, EASY_JSON_FE_55, EASY_JSON_FE_54, EASY_JSON_FE_53, EASY_JSON_FE_52, EASY_JSON_FE_51, EASY_JSON_FE_50, EASY_JSON_FE_49, \
+    EASY_JSON_FE_48, EASY_JSON_FE_47, EASY_JSON_FE_46, EASY_JSON_FE_45, EASY_JSON_FE_44, EASY_JSON_FE_43, EASY_JSON_FE_42, EASY_JSON_FE_41, \
+    EASY_JSON_FE_40, EASY_JSON_FE_39, EASY_JSON_FE_38, EASY_JSON_FE_37, EASY_JSON_FE_36, EASY_JSON_FE_35, EASY_JSON_FE_34, EASY_JSON_FE_33, \
+    EASY_JSON_FE_32, EASY_JSON_FE_31, EASY_JSON_FE_30, EASY_JSON_FE_29, EASY_JSON_FE_28, EASY_JSON_FE_27, EASY_JSON_FE_26, EASY_JSON_FE_25, \
+    EASY_JSON_FE_24, EASY_JSON_FE_23, EASY_JSON_FE_22, EASY_JSON_FE_21, EASY_JSON_FE_20, EASY_JSON_FE_19, EASY_JSON_FE_18, EASY_JSON_FE_17, \
+    EASY_JSON_FE_16, EASY_JSON_FE_15, EASY_JSON_FE_14, EASY_JSON_FE_13, EASY_JSON_FE_12, EASY_JSON_FE_11, EASY_JSON_FE_10, EASY_JSON_FE_9, \
+    EASY_JSON_FE_8, EASY_JSON_FE_7, EASY_JSON_FE_6, EASY_JSON_FE_5, EASY_JSON_FE_4, EASY_JSON_FE_3, EASY_JSON_FE_2, EASY_JSON_FE_1)(m, t, __VA_ARGS__))
+
+#define EASY_JSON_BIND_FIELD(Type, field) \
+    ::easy_json::JsonField<Type, decltype(Type::field)>{ #field, &Type::field }
+#define EASY_JSON_BIND(Type, ...) \
+    constexpr auto easy_json_fields(const Type *) \
+    { \
+        return std::make_tuple(EASY_JSON_FOR_EACH(EASY_JSON_BIND_FIELD, Type, __VA_ARGS__)); \
+    }
+
+#define EASY_JSON_BIND_ENUMERATOR(Type, name) \
+    ::easy_json::JsonEnumerator<Type>{ #name, Type::name }
+#define EASY_JSON_BIND_ENUM(Type, ...) \
+    constexpr auto easy_json_enumerators(const Type *) \
+    { \
+        return ::easy_json::make_enumerators<Type>(EASY_JSON_FOR_EACH(EASY_JSON_BIND_ENUMERATOR, Type, __VA_ARGS__)); \
+    }
+
+namespace easy_json {
+    template <typename Class, typename Member>
+    struct JsonField
+    {
+        std::string_view name;
+        Member Class::* member;
+    };
+
+    template <typename Enum>
+    struct JsonEnumerator
+    {
+        std::string_view name;
+        Enum value;
+    };
+
+    template <typename Enum, typename... Enumerators>
+    constexpr std::array<JsonEnumerator<Enum>, sizeof...(Enumerators)> make_enumerators(Enumerators... enumerators)
+    {
+        return { { enumerators... } };
+    }
+
+    // Forward only reader the bindings pull values from. Views returned by
+    // read_string() are valid until the next string is read. Objects and
+    // arrays nest up to max_depth, skipped values included.
+    class JsonPullReader
+    {
+    public:
+        JsonPullReader(const char * str, size_t length) : _begin(str), _p(str), _end(str + length)
+        {
+            if (length >= 3 &&
+                static_cast<unsigned char>(str[0]) == 0XEF &&
+                static_cast<unsigned char>(str[1]) == 0XBB &&
+                static_cast<unsigned char>(str[2]) == 0XBF) // UTF-8 BOM
+                _p += 3;
+        }
+
+        // next non blank byte, '\0' at the end of the input
+        char peek()
+        {
+            while (_p < _end && (*_p == ' ' || *_p == '\n' || *_p == '\r' || *_p == '\t'))
+                ++_p;
+            return _p < _end ? *_p : '\0';
+        }
+
+        bool consume(char c)
+        {
+            if (peek() != c)
+                return false;
+            ++_p;
+            return true;
+        }
+
+        void set_max_depth(uint32_t depth) { _max_depth = depth; }
+
+        // true once only blanks are left
+        bool at_end()
+        {
+            peek();
+            return _p == _end;
+        }
+
+        bool read_string(std::string_view & value)
+        {
+            if (peek() != '\"')
+                return fail();
+            const char * begin = ++_p;
+            const char * run_end = scan_string(_p, _end);
+            if (run_end < _end && *run_end == '\"')
+            {
+                value = std::string_view(begin, run_end - begin);
+                _p = run_end + 1;
+                return true;
+            }
+
+            _buffer.assign(begin, run_end - begin);
+            _p = run_end;
+            while (true)
+            {
+                if (_p >= _end)
+                    return fail();
+                if (*_p == '\"')
+                    break;
+                _p = decode_escape(_p, _end, _buffer);
+                if (_p == nullptr)
+                {
+                    _p = _end;
+                    return fail();
+                }
+                run_end = scan_string(_p, _end);
+                _buffer.append(_p, run_end - _p);
+                _p = run_end;
+            }
+            ++_p;
+            value = _buffer;
+            return true;
+        }
+
+        bool read_number(JsonNumberValue & value)
+        {
+            peek();
+            const char * end = parse_number(_p, _end, value);
+            if (end == nullptr)
+                return fail();
+            _p = end;
+            return true;
+        }
+
+        bool read_boolean(bool & value)
+        {
+            char c = peek();
+            if (c == 't' && read_literal("true", 4))
+                value = true;
+            else if (c == 'f' && read_literal("false", 5))
+                value = false;
+            else
+                return fail();
+            return true;
+        }
+
+        bool read_null()
+        {
+            return (peek() == 'n' && read_literal("null", 4)) || fail();
+        }
+
+        // on_member(key) reads the value of every member
+        template <typename Callback>
+        bool read_object(Callback && on_member)
+        {
+            if (!open('{'))
+                return fail();
+            if (consume('}'))
+                return close();
+            do
+            {
+                std::string_view key;
+                if (!read_string(key) || !consume(':'))
+                    return fail();
+                if (!on_member(key))
+                    return fail();
+            } while (consume(','));
+            return (consume('}') && close()) || fail();
+        }
+
+        // on_element() reads every element
+        template <typename Callback>
+        bool read_array(Callback && on_element)
+        {
+            if (!open('['))
+                return fail();
+            if (consume(']'))
+                return close();
+            do
+            {
+                if (!on_element())
+                    return fail();
+            } while (consume(','));
+            return (consume(']') && close()) || fail();
+        }
+
+        // iterative, skipped containers are tracked in _skipping
+        bool skip_value()
+        {
+            std::string_view str;
+            JsonNumberValue number;
+            bool b;
+            size_t base = _skipping.size();
+            while (true)
+            {
+                char c = peek();
+                switch (c)
+                {
+                case '{':
+                case '[':
+                    if (!open(c))
+                        return fail();
+                    if (consume(c == '{' ? '}' : ']'))
+                    {
+                        close();
+                        break;
+                    }
+                    _skipping.push_back(c);
+                    if (c == '{' && (!read_string(str) || !consume(':')))
+                        return fail();
+                    continue;
+                case '\"':
+                    if (!read_string(str))
+                        return false;
+                    break;
+                case 't':
+                case 'f':
+                    if (!read_boolean(b))
+                        return false;
+                    break;
+                case 'n':
+                    if (!read_null())
+                        return false;
+                    break;
+                default:
+                    if (!read_number(number))
+                        return false;
+                    break;
+                }
+
+                // a value is done: on to the next member or out of containers
+                while (_skipping.size() > base)
+                {
+                    bool object = _skipping.back() == '{';
+                    if (consume(','))
+                    {
+                        if (object && (!read_string(str) || !consume(':')))
+                            return fail();
+                        break;
+                    }
+                    if (!consume(object ? '}' : ']'))
+                        return fail();
+                    _skipping.pop_back();
+                    close();
+                }
+                if (_skipping.size() == base)
+                    return true;
+            }
+        }
+
+        bool fail()
+        {
+            _failed = true;
+            return false;
+        }
+
+        bool failed() const { return _failed; }
+        size_t offset() const { return _p - _begin; }
+
+    private:
+        // a failed reader is not reused, so only closing restores the depth
+        bool open(char c)
+        {
+            if (_depth >= _max_depth || !consume(c))
+                return false;
+            ++_depth;
+            return true;
+        }
+
+        bool close()
+        {
+            --_depth;
+            return true;
+        }
+
+        bool read_literal(const char * literal, size_t size)
+        {
+            if (static_cast<size_t>(_end - _p) < size || memcmp(_p, literal, size) != 0)
+                return false;
+            _p += size;
+            return true;
+        }
+
+        const char * _begin;
+        const char * _p;
+        const char * _end;
+        bool _failed = false;
+        uint32_t _depth = 0;
+        uint32_t _max_depth = JsonParseLimits().max_depth;
+        std::string _buffer;
+        std::string _skipping;    // containers open in skip_value()
+    };
+
+    // read(reader, value) / write(writer, value) for every bindable type
+    template <typename T, typename Enable = void>
+    struct JsonBinder
+    {
+        static_assert(sizeof(T) == 0, "type is not bindable, declare it with EASY_JSON_BIND");
+    };
+
+    template <typename T, typename = void>
+    struct has_json_fields : std::false_type {};
+    template <typename T>
+    struct has_json_fields<T, std::void_t<decltype(easy_json_fields(static_cast<const T *>(nullptr)))>> : std::true_type {};
+
+    template <typename T, typename = void>
+    struct has_json_enumerators : std::false_type {};
+    template <typename T>
+    struct has_json_enumerators<T, std::void_t<decltype(easy_json_enumerators(static_cast<const T *>(nullptr)))>> : std::true_type {};
+
+    template <typename T>
+    bool from_json(std::string_view text, T & value)
+    {
+        JsonPullReader reader(text.data(), text.size());
+        return JsonBinder<T>::read(reader, value) && reader.at_end();
+    }
+
+    template <typename T>
+    void to_json(JsonWriter & writer, const T & value)
+    {
+        JsonBinder<T>::write(writer, value);
+    }
+
+    template <typename T>
+    std::string to_json(const T & value)
+    {
+        std::string out;
+        {
+            JsonWriter writer(out, 256);
+            JsonBinder<T>::write(writer, value);
+            writer.flush();
+        }
+        return out;
+    }
+
+    template <>
+    struct JsonBinder<bool>
+    {
+        static bool read(JsonPullReader & reader, bool & value) { return reader.read_boolean(value); }
+        static void write(JsonWriter & writer, bool value) { writer.boolean(value); }
+    };
+
+    // integers only take integer tokens that fit
+    template <typename T>
+    struct JsonBinder<T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>>
+    {
+        static bool read(JsonPullReader & reader, T & value)
+        {
+            JsonNumberValue number;
+            if (!reader.read_number(number))
+                return false;
+            if (number.type == JsonNumberType::Int64)
+            {
+                if (std::is_unsigned<T>::value ? number.i < 0 || static_cast<uint64_t>(number.i) > static_cast<uint64_t>(std::numeric_limits<T>::max())
+                                               : number.i < static_cast<int64_t>(std::numeric_limits<T>::min()) || number.i > static_cast<int64_t>(std::numeric_limits<T>::max()))
+                    return reader.fail();
+                value = static_cast<T>(number.i);
+                return true;
+            }
+            if (number.type == JsonNumberType::Uint64 && number.u <= static_cast<uint64_t>(std::numeric_limits<T>::max()))
+            {
+                value = static_cast<T>(number.u);
+                return true;
+            }
+            return reader.fail();
+        }
+
+        static void write(JsonWriter & writer, T value)
+        {
+            if (std::is_signed<T>::value)
+                writer.integer(static_cast<int64_t>(value));
+            else
+                writer.unsigned_integer(static_cast<uint64_t>(value));
+        }
+    };
+
+    template <typename T>
+    struct JsonBinder<T, std::enable_if_t<std::is_floating_point<T>::value>>
+    {
+        static bool read(JsonPullReader & reader, T & value)
+        {
+            JsonNumberValue number;
+            if (!reader.read_number(number))
+                return false;
+            value = static_cast<T>(number.type == JsonNumberType::Int64 ? static_cast<double>(number.i)
+                                   : number.type == JsonNumberType::Uint64 ? static_cast<double>(number.u)
+                                   : number.d);
+            return true;
+        }
+
+        static void write(JsonWriter & writer, T value) { writer.number(static_cast<double>(value)); }
+    };
+
+    template <>
+    struct JsonBinder<std::string>
+    {
+        static bool read(JsonPullReader & reader, std::string & value)
+        {
+            std::string_view str;
+            if (!reader.read_string(str))
+                return false;
+            value.assign(str.data(), str.size());
+            return true;
+        }
+
+        static void write(JsonWriter & writer, const std::string & value) { writer.string(value); }
+    };
+
+    // registered enums are written by name, others as their underlying value
+    template <typename T>
+    struct JsonBinder<T, std::enable_if_t<std::is_enum<T>::value>>
+    {
+        typedef std::underlying_type_t<T> Underlying;
+
+        static bool read(JsonPullReader & reader, T & value)
+        {
+            if constexpr (has_json_enumerators<T>::value)
+            {
+                std::string_view name;
+                if (!reader.read_string(name))
+                    return false;
+                for (const auto & enumerator : easy_json_enumerators(static_cast<const T *>(nullptr)))
+                {
+                    if (enumerator.name == name)
+                    {
+                        value = enumerator.value;
+                        return true;
+                    }
+                }
+                return reader.fail();
+            }
+            else
+            {
+                Underlying number;
+                if (!JsonBinder<Underlying>::read(reader, number))
+                    return false;
+                value = static_cast<T>(number);
+                return true;
+            }
+        }
+
+        static void write(JsonWriter & writer, T value)
+        {
+            if constexpr (has_json_enumerators<T>::value)
+            {
+                for (const auto & enumerator : easy_json_enumerators(static_cast<const T *>(nullptr)))
+                {
+                    if (enumerator.value == value)
+                    {
+                        writer.string(enumerator.name);
+                        return;
+                    }
+                }
+            }
+            JsonBinder<Underlying>::write(writer, static_cast<Underlying>(value));
+        }
+    };
+
+    template <typename T>
+    struct JsonBinder<std::optional<T>>
+    {
+        static bool read(JsonPullReader & reader, std::optional<T> & value)
+        {
+            if (reader.peek() == 'n')
+            {
+                value.reset();
+                return reader.read_null();
+            }
+            if (!value)
+                value.emplace();
+            return JsonBinder<T>::read(reader, *value);
+        }
+
+        static void write(JsonWriter & writer, const std::optional<T> & value)
+        {
+            if (value)
+                JsonBinder<T>::write(writer, *value);
+            else
+                writer.null();
+        }
+    };
+
+    template <typename T, typename Allocator>
+    struct JsonBinder<std::vector<T, Allocator>>
+    {
+        static bool read(JsonPullReader & reader, std::vector<T, Allocator> & value)
+        {
+            value.clear();
+            return reader.read_array([&]() {
+                value.emplace_back();
+                return JsonBinder<T>::read(reader, value.back());
+            });
+        }
+
+        static void write(JsonWriter & writer, const std::vector<T, Allocator> & value)
+        {
+            writer.begin_array();
+            for (const auto & element : value)
+                JsonBinder<T>::write(writer, element);
+            writer.end_array();
+        }
+    };
+
+    // string keyed maps: std::map, std::unordered_map
+    template <typename Map>
+    struct JsonMapBinder
+    {
+        typedef typename Map::mapped_type T;
+
+        static bool read(JsonPullReader & reader, Map & value)
+        {
+            value.clear();
+            return reader.read_object([&](std::string_view key) {
+                // the key view does not survive reading the value
+                return JsonBinder<T>::read(reader, value[std::string(key)]);
+            });
+        }
+
+        static void write(JsonWriter & writer, const Map & value)
+        {
+            writer.begin_object();
+            for (const auto & member : value)
+            {
+                writer.key(member.first);
+                JsonBinder<T>::write(writer, member.second);
+            }
+            writer.end_object();
+        }
+    };
+
+    template <typename T, typename Compare, typename Allocator>
+    struct JsonBinder<std::map<std::string, T, Compare, Allocator>> : JsonMapBinder<std::map<std::string, T, Compare, Allocator>> {};
+
+    template <typename T, typename Hash, typename Equal, typename Allocator>
+    struct JsonBinder<std::unordered_map<std::string, T, Hash, Equal, Allocator>>
+        : JsonMapBinder<std::unordered_map<std::string, T, Hash, Equal, Allocator>> {};
+
+    // Compile time key table of a bound struct: the names are hashed into
+    // buckets when the type is instantiated, the seed picked to keep buckets
+    // short, so a member lookup is one hash and usually one compare.
+    template <size_t N>
+    struct JsonKeyTable
+    {
+        static constexpr size_t bucket_count()
+        {
+            size_t buckets = 4;
+            while (buckets < 2 * N)
+                buckets <<= 1;
+            return buckets;
+        }
+
+        static constexpr size_t BUCKETS = bucket_count();
+
+        uint32_t seed = 0;
+        std::array<uint16_t, BUCKETS + 1> start = {};
+        std::array<uint16_t, N> items = {};
+
+        static constexpr uint32_t hash(std::string_view key, uint32_t seed)
+        {
+            uint32_t h = 2166136261u ^ seed;
+            for (char c : key)
+            {
+                h ^= static_cast<uint8_t>(c);
+                h *= 16777619u;
+            }
+            return h;
+        }
+
+        static constexpr JsonKeyTable build(const std::array<std::string_view, N> & names)
+        {
+            // seed with the shortest longest bucket
+            uint32_t best_seed = 0;
+            size_t best_chain = N + 1;
+            for (uint32_t seed = 0; seed < 32 && best_chain > 1; ++seed)
+            {
+                std::array<uint16_t, BUCKETS> sizes = {};
+                size_t chain = 0;
+                for (size_t i = 0; i < N; ++i)
+                {
+                    size_t b = hash(names[i], seed) & (BUCKETS - 1);
+                    if (++sizes[b] > chain)
+                        chain = sizes[b];
+                }
+                if (chain < best_chain)
+                {
+                    best_chain = chain;
+                    best_seed = seed;
+                }
+            }
+
+            JsonKeyTable table;
+            table.seed = best_seed;
+            for (size_t i = 0; i < N; ++i)
+                ++table.start[(hash(names[i], best_seed) & (BUCKETS - 1)) + 1];
+            for (size_t b = 0; b < BUCKETS; ++b)
+                table.start[b + 1] += table.start[b];
+            std::array<uint16_t, BUCKETS> fill = {};
+            for (size_t i = 0; i < N; ++i)
+            {
+                size_t b = hash(names[i], best_seed) & (BUCKETS - 1);
+                table.items[table.start[b] + fill[b]++] = static_cast<uint16_t>(i);
+            }
+            return table;
+        }
+
+        // index of key in names, -1 when it is not a member
+        constexpr int find(std::string_view key, const std::array<std::string_view, N> & names) const
+        {
+            size_t b = hash(key, seed) & (BUCKETS - 1);
+            for (size_t i = start[b]; i < start[b + 1]; ++i)
+            {
+                if (names[items[i]] == key)
+                    return items[i];
+            }
+            return -1;
+        }
+    };
+
+    template <typename T>
+    struct JsonStructBinder
+    {
+        static constexpr auto fields = easy_json_fields(static_cast<const T *>(nullptr));
+        static constexpr size_t COUNT = std::tuple_size<std::decay_t<decltype(fields)>>::value;
+
+        template <size_t... I>
+        static constexpr std::array<std::string_view, COUNT> field_names(std::index_sequence<I...>)
+        {
+            return { { std::get<I>(fields).name... } };
+        }
+
+        static constexpr std::array<std::string_view, COUNT> names = field_names(std::make_index_sequence<COUNT>());
+        static constexpr JsonKeyTable<COUNT> table = JsonKeyTable<COUNT>::build(names);
+
+        template <size_t I>
+        static bool read_field(JsonPullReader & reader, T & value)
+        {
+            auto & member = value.*(std::get<I>(fields).member);
+            return JsonBinder<std::decay_t<decltype(member)>>::read(reader, member);
+        }
+
+        typedef bool (*ReadField)(JsonPullReader &, T &);
+
+        template <size_t... I>
+        static constexpr std::array<ReadField, COUNT> field_readers(std::index_sequence<I...>)
+        {
+            return { { &read_field<I>... } };
+        }
+
+        static constexpr std::array<ReadField, COUNT> readers = field_readers(std::make_index_sequence<COUNT>());
+
+        static bool read(JsonPullReader & reader, T & value)
+        {
+            return reader.read_object([&](std::string_view key) {
+                int index = table.find(key, names);
+                return index < 0 ? reader.skip_value() : readers[index](reader, value);
+            });
+        }
+
+        template <typename Member>
+        static void write_field(JsonWriter & writer, std::string_view name, const Member & member)
+        {
+            writer.key(name);
+            JsonBinder<Member>::write(writer, member);
+        }
+
+        template <typename Member>
+        static void write_field(JsonWriter & writer, std::string_view name, const std::optional<Member> & member)
+        {
+            if (member)
+                write_field(writer, name, *member);
+        }
+
+        template <size_t... I>
+        static void write_fields(JsonWriter & writer, const T & value, std::index_sequence<I...>)
+        {
+            (write_field(writer, std::get<I>(fields).name, value.*(std::get<I>(fields).member)), ...);
+        }
+
+        static void write(JsonWriter & writer, const T & value)
+        {
+            writer.begin_object();
+            write_fields(writer, value, std::make_index_sequence<COUNT>());
+            writer.end_object();
+        }
+    };
+
+    template <typename T>
+    struct JsonBinder<T, std::enable_if_t<has_json_fields<T>::value>> : JsonStructBinder<T> {};
+} // namespace easy_json
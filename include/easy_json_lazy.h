@@ -0,0 +1,119 @@
+﻿#pragma once
+#include "easy_json.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace easy_json {
+    class JsonLazyDocument;
+
+    // Handle to a value of a JsonLazyDocument, cheap to copy. Stays valid as
+    // long as its document is open.
+    class JsonLazyValue
+    {
+    public:
+        JsonLazyValue() = default;
+
+        // false for missing properties, out of range indexes and syntax errors
+        bool valid() const { return _document != nullptr; }
+        JsonType type() const;
+
+        bool is_string() const { return type() == JsonType::String; }
+        bool is_boolean() const { return type() == JsonType::Boolean; }
+        bool is_number() const { return type() == JsonType::Number; }
+        bool is_object() const { return type() == JsonType::Object; }
+        bool is_array() const { return type() == JsonType::Array; }
+        bool is_null() const { return valid() && type() == JsonType::Null; }
+
+        std::string to_str() const { return std::string(str_view()); }
+        std::string_view str_view() const;
+        bool to_boolean() const;
+        int64_t to_integer() const;
+        uint64_t to_unsigned() const;
+        double to_number() const;
+
+        // object members are read from the input to the end of the object,
+        // the last of duplicate keys wins as in JsonObject. Arrays are read
+        // up to index. Values passed over are skipped without being parsed.
+        JsonLazyValue get_property(std::string_view key) const;
+        JsonLazyValue get_property(const char * key) const { return get_property(std::string_view(key ? key : "")); }
+        JsonLazyValue at(int index) const;
+        // reads the whole container
+        size_t count() const;
+
+        // text of the value in the input, e.g. for JsonDocument::parse
+        std::string_view raw() const;
+
+    private:
+        friend class JsonLazyDocument;
+        JsonLazyValue(JsonLazyDocument * document, uint32_t node) : _document(document), _node(node) {}
+
+        JsonLazyDocument * _document = nullptr;
+        uint32_t _node = 0;
+    };
+
+    // On-demand view of a JSON text: nothing is parsed up front. Containers are
+    // read forward as far as the accessed members, unread values are skipped
+    // by bracket matching and every value visited once is cached, so
+    // revisiting a path does not touch the input again. Skipped values are
+    // not validated. The input must outlive the document.
+    class JsonLazyDocument
+    {
+    public:
+        JsonLazyDocument();
+        ~JsonLazyDocument();
+
+        JsonLazyDocument(const JsonLazyDocument &) = delete;
+        JsonLazyDocument & operator=(const JsonLazyDocument &) = delete;
+
+        // the root must be an object or an array
+        bool open(const char * str, size_t length);
+        bool open(std::string_view str) { return open(str.data(), str.size()); }
+        void close();
+
+        JsonLazyValue root();
+        // set once malformed input was met while reading
+        bool failed() const { return _failed; }
+
+    private:
+        friend class JsonLazyValue;
+
+        static constexpr uint32_t NONE = UINT32_MAX;
+
+        struct Entry
+        {
+            std::string_view key;    // decoded, arrays leave it empty
+            uint32_t node;           // NONE until the value is visited
+            size_t value;            // offset of the value
+        };
+
+        struct Node
+        {
+            JsonType type;
+            bool complete;           // every entry discovered
+            size_t begin;
+            size_t end;              // offset past the value, 0 while unknown
+            std::string_view string;    // decoded string values
+            std::vector<Entry> entries;
+        };
+
+        uint32_t add_node(size_t offset);
+        uint32_t child(uint32_t node, size_t index);
+        bool next_entry(uint32_t node);
+        size_t node_end(uint32_t node);
+        size_t value_end(size_t offset);
+        size_t skip_space(size_t offset) const;
+        size_t skip_string(size_t offset);
+        size_t skip_container(size_t offset);
+        bool read_string(size_t & offset, std::string_view & value);
+        void fail() { _failed = true; }
+
+        const char * _text = nullptr;
+        size_t _size = 0;
+        bool _failed = false;
+        std::vector<Node> _nodes;
+        JsonArena _strings;    // decoded escaped strings
+        std::string _buffer;
+    };
+} // namespace easy_json
@@ -0,0 +1,71 @@
+﻿#pragma once
+#include "easy_json.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace easy_json {
+    // Parses JSON Lines / NDJSON: one document per line, blank lines skipped.
+    // The input is cut into chunks at line boundaries and the chunks are
+    // parsed by a pool of threads that steal work from each other.
+    class JsonLinesParser
+    {
+    public:
+        struct Options
+        {
+            unsigned threads = 0;            // 0: one per hardware thread
+            size_t chunk_size = 256 * 1024;  // bytes of input per task
+            uint32_t flags = JSON_PARSE_DEFAULT;
+        };
+
+        struct Record
+        {
+            size_t line = 0;            // 0-based line number in the input
+            size_t offset = 0;          // byte offset of the line in the input
+            bool ok = false;
+            int error = 0;              // JsonParseError of the line
+            size_t error_offset = 0;    // position of the error within the line
+            std::unique_ptr<JsonDocument> document;    // null on error / in callbacks
+        };
+
+        // Called concurrently from the worker threads, in no particular order.
+        // document is nullptr when the line failed to parse and is only valid
+        // for the duration of the call, each worker recycles one document.
+        typedef std::function<void(const Record & record, JsonDocument * document)> Callback;
+
+        JsonLinesParser();
+        explicit JsonLinesParser(const Options & options);
+
+        // one record per non blank line, in input order
+        std::vector<Record> parse(const char * data, size_t size);
+        // returns false when at least one line failed
+        bool parse(const char * data, size_t size, const Callback & callback);
+
+        // JSON_PARSE_BORROW_INPUT is ignored, the file is unmapped on return
+        std::vector<Record> parse_file(const char * path);
+        bool parse_file(const char * path, const Callback & callback);
+
+        size_t lines() const { return _lines; }
+        size_t failures() const { return _failures; }
+
+    private:
+        struct Chunk
+        {
+            const char * begin;
+            const char * end;
+            size_t first_line;
+            size_t line_count;
+        };
+
+        template <typename Task>
+        void run(size_t task_count, const Task & task);
+        void split(const char * data, size_t size);
+        unsigned thread_count() const;
+
+        Options _options;
+        std::vector<Chunk> _chunks;
+        size_t _lines = 0;
+        size_t _failures = 0;
+    };
+} // namespace easy_json
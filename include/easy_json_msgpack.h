@@ -0,0 +1,245 @@
+﻿#pragma once
+#include "easy_json_reader.h"
+
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace easy_json {
+    // MessagePack encoding of JSON values. Documents are written with
+    // JsonAny::dump_msgpack() and read back with JsonAny / JsonDocument
+    // ::parse_msgpack(), or read in place through JsonMsgPackValue.
+    enum class JsonMsgPackKind : uint8_t
+    {
+        Nil,
+        False,
+        True,
+        Int,        // value holds the int64 bits
+        Uint,
+        Float32,    // value holds the IEEE bits
+        Float64,
+        String,     // value is the payload length
+        Binary,
+        Ext,        // value is the payload length including the type byte
+        Array,      // value is the element count
+        Map,        // value is the member count
+        Invalid,
+    };
+
+    struct JsonMsgPackHeader
+    {
+        JsonMsgPackKind kind = JsonMsgPackKind::Invalid;
+        uint64_t value = 0;
+    };
+
+    // Decodes the type byte and fixed size fields at p. Returns the payload
+    // start (the first child for containers) or nullptr when the input is
+    // truncated or the type byte is reserved. Payload bounds are left to the caller.
+    const uint8_t * msgpack_header(const uint8_t * p, const uint8_t * end, JsonMsgPackHeader & header);
+
+    // Returns the end of the value at p, nullptr when it is malformed
+    const uint8_t * msgpack_skip(const uint8_t * p, const uint8_t * end);
+
+    // Event parser over MessagePack, drives the same handlers as JsonReader.
+    // Map keys must be strings, binary and extension values are rejected as
+    // they have no JSON counterpart.
+    template <typename Handler>
+    class JsonMsgPackReader
+    {
+    public:
+        JsonMsgPackReader(const char * data, size_t size, uint32_t flags = JSON_PARSE_DEFAULT)
+            : _begin(reinterpret_cast<const uint8_t *>(data)), _p(_begin), _end(_begin + size), _flags(flags)
+        {
+        }
+
+        void set_limits(const JsonParseLimits & limits) { _limits = limits; }
+
+        // reads one value, trailing bytes are ignored
+        bool parse(Handler & handler)
+        {
+            _handler = &handler;
+            _p = _begin;
+            _error = JSON_ERROR_NONE;
+            _depth = 0;
+            _nodes = 0;
+            if (static_cast<size_t>(_end - _begin) > _limits.max_document_size)
+                return fail(JSON_ERROR_DOCUMENT_SIZE);
+            return parse_value();
+        }
+
+        // JsonParseError of the last parse
+        int error() const { return _error; }
+        size_t offset() const { return _p - _begin; }
+
+    private:
+        bool fail(int error)
+        {
+            _error = error;
+            return false;
+        }
+
+        bool read_string(const JsonMsgPackHeader & header, const uint8_t * payload, std::string_view & value)
+        {
+            if (static_cast<uint64_t>(_end - payload) < header.value)
+                return fail(JSON_ERROR_SYNTAX);
+            if (header.value > _limits.max_string_length)
+                return fail(JSON_ERROR_STRING_LENGTH);
+            value = std::string_view(reinterpret_cast<const char *>(payload), static_cast<size_t>(header.value));
+            _p = payload + header.value;
+            return true;
+        }
+
+        bool number(JsonNumberValue & number, const uint8_t * payload)
+        {
+            _p = payload;
+            return _handler->on_number(number, std::string_view()) || fail(JSON_ERROR_HANDLER);
+        }
+
+        // recursion is bounded by max_depth
+        bool parse_value()
+        {
+            JsonMsgPackHeader header;
+            const uint8_t * payload = msgpack_header(_p, _end, header);
+            if (payload == nullptr)
+                return fail(JSON_ERROR_SYNTAX);
+            if (++_nodes > _limits.max_nodes)
+                return fail(JSON_ERROR_NODE_COUNT);
+
+            JsonNumberValue value;
+            bool stable = (_flags & JSON_PARSE_BORROW_INPUT) != 0;
+            switch (header.kind)
+            {
+            case JsonMsgPackKind::Nil:
+                _p = payload;
+                return _handler->on_null() || fail(JSON_ERROR_HANDLER);
+            case JsonMsgPackKind::False:
+            case JsonMsgPackKind::True:
+                _p = payload;
+                return _handler->on_boolean(header.kind == JsonMsgPackKind::True) || fail(JSON_ERROR_HANDLER);
+            case JsonMsgPackKind::Int:
+                value.type = JsonNumberType::Int64;
+                value.i = static_cast<int64_t>(header.value);
+                return number(value, payload);
+            case JsonMsgPackKind::Uint:
+                value.type = header.value <= static_cast<uint64_t>(INT64_MAX) ? JsonNumberType::Int64 : JsonNumberType::Uint64;
+                value.u = header.value;
+                return number(value, payload);
+            case JsonMsgPackKind::Float32:
+            {
+                float f;
+                uint32_t bits = static_cast<uint32_t>(header.value);
+                memcpy(&f, &bits, sizeof(f));
+                value.type = JsonNumberType::Double;
+                value.d = f;
+                return number(value, payload);
+            }
+            case JsonMsgPackKind::Float64:
+                value.type = JsonNumberType::Double;
+                memcpy(&value.d, &header.value, sizeof(value.d));
+                return number(value, payload);
+            case JsonMsgPackKind::String:
+            {
+                std::string_view text;
+                if (!read_string(header, payload, text))
+                    return false;
+                return _handler->on_string(text, stable) || fail(JSON_ERROR_HANDLER);
+            }
+            case JsonMsgPackKind::Array:
+            {
+                _p = payload;
+                if (++_depth > _limits.max_depth)
+                    return fail(JSON_ERROR_DEPTH);
+                if (!_handler->on_start_array())
+                    return fail(JSON_ERROR_HANDLER);
+                for (uint64_t i = 0; i < header.value; ++i)
+                {
+                    if (!parse_value())
+                        return false;
+                }
+                --_depth;
+                return _handler->on_end_array(static_cast<size_t>(header.value)) || fail(JSON_ERROR_HANDLER);
+            }
+            case JsonMsgPackKind::Map:
+            {
+                _p = payload;
+                if (++_depth > _limits.max_depth)
+                    return fail(JSON_ERROR_DEPTH);
+                if (!_handler->on_start_object())
+                    return fail(JSON_ERROR_HANDLER);
+                for (uint64_t i = 0; i < header.value; ++i)
+                {
+                    JsonMsgPackHeader key_header;
+                    const uint8_t * key_payload = msgpack_header(_p, _end, key_header);
+                    std::string_view key;
+                    if (key_payload == nullptr || key_header.kind != JsonMsgPackKind::String)
+                        return fail(JSON_ERROR_SYNTAX);
+                    if (!read_string(key_header, key_payload, key))
+                        return false;
+                    if (!_handler->on_key(key, stable))
+                        return fail(JSON_ERROR_HANDLER);
+                    if (!parse_value())
+                        return false;
+                }
+                --_depth;
+                return _handler->on_end_object(static_cast<size_t>(header.value)) || fail(JSON_ERROR_HANDLER);
+            }
+            default:
+                // bin / ext have no JSON counterpart
+                return fail(JSON_ERROR_SYNTAX);
+            }
+        }
+
+        const uint8_t * _begin;
+        const uint8_t * _p;
+        const uint8_t * _end;
+        uint32_t _flags;
+        Handler * _handler = nullptr;
+        JsonParseLimits _limits;
+        int _error = JSON_ERROR_NONE;
+        uint32_t _depth = 0;
+        size_t _nodes = 0;
+    };
+
+    // Read-only view of an encoded value, accessed in place without decoding.
+    // Members and elements are found by skipping over their predecessors.
+    // The encoded buffer must outlive the view.
+    class JsonMsgPackValue
+    {
+    public:
+        JsonMsgPackValue() = default;
+        JsonMsgPackValue(const char * data, size_t size);
+
+        bool valid() const { return _p != nullptr; }
+        JsonType type() const;
+
+        bool is_string() const { return type() == JsonType::String; }
+        bool is_boolean() const { return type() == JsonType::Boolean; }
+        bool is_number() const { return type() == JsonType::Number; }
+        bool is_object() const { return type() == JsonType::Object; }
+        bool is_array() const { return type() == JsonType::Array; }
+        bool is_null() const { return valid() && type() == JsonType::Null; }
+
+        std::string to_str() const { return std::string(str_view()); }
+        std::string_view str_view() const;
+        bool to_boolean() const;
+        int64_t to_integer() const;
+        uint64_t to_unsigned() const;
+        double to_number() const;
+
+        size_t count() const;
+        JsonMsgPackValue get_property(std::string_view key) const;
+        JsonMsgPackValue get_property(const char * key) const { return get_property(std::string_view(key ? key : "")); }
+        JsonMsgPackValue at(int index) const;
+
+        // encoded bytes of the value
+        std::string_view raw() const;
+
+    private:
+        JsonMsgPackValue(const uint8_t * p, const uint8_t * end) : _p(p), _end(end) {}
+        JsonMsgPackHeader header(const uint8_t ** payload = nullptr) const;
+        JsonMsgPackValue child(const uint8_t * p) const;
+
+        const uint8_t * _p = nullptr;
+        const uint8_t * _end = nullptr;
+    };
+} // namespace easy_json
@@ -0,0 +1,72 @@
+﻿#pragma once
+#include "easy_json.h"
+#include "easy_json_lazy.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace easy_json {
+    // Path to a single value, compiled once and reused: keys are hashed for
+    // JsonObject::get_property and array indexes parsed up front.
+    class JsonPath
+    {
+    public:
+        JsonPath() = default;
+
+        // RFC 6901 JSON Pointer, "" is the root and "/a/~1b/0" reads a, "/b", 0
+        bool compile_pointer(std::string_view pointer);
+        // JSONPath subset without wildcards or filters: $.a.b, $['a.b'], $[0]
+        bool compile(std::string_view path);
+
+        // nullptr / an invalid value when a step is missing
+        JsonAny * find(const JsonAny * root) const;
+        JsonLazyValue find(JsonLazyValue root) const;
+
+        size_t size() const { return _steps.size(); }
+
+    private:
+        friend class JsonPathSet;
+
+        struct Step
+        {
+            std::string key;
+            uint32_t hash;
+            int64_t index;    // -1 when the token is not an array index
+        };
+
+        void add_step(std::string key, bool may_be_index);
+
+        std::vector<Step> _steps;
+    };
+
+    // Many paths evaluated in one traversal. Paths are merged into a prefix
+    // tree so a shared prefix is looked up once per document.
+    class JsonPathSet
+    {
+    public:
+        JsonPathSet();
+
+        // returns the id of the path, its slot in the results
+        size_t add(const JsonPath & path);
+        size_t size() const { return _count; }
+
+        // results[id] is nullptr / invalid for paths that are missing
+        void find(const JsonAny * root, std::vector<JsonAny *> & results) const;
+        void find(JsonLazyValue root, std::vector<JsonLazyValue> & results) const;
+
+    private:
+        struct Node
+        {
+            JsonPath::Step step;
+            std::vector<uint32_t> children;
+            std::vector<uint32_t> paths;    // ids of the paths ending here
+        };
+
+        template <typename Value>
+        void walk(uint32_t node, Value value, std::vector<Value> & results) const;
+
+        std::vector<Node> _nodes;
+        size_t _count = 0;
+    };
+} // namespace easy_json
@@ -0,0 +1,448 @@
+﻿#pragma once
+#include "easy_json_reader.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace easy_json {
+    // Resumable event parser: the document arrives through any number of
+    // feed() calls, split anywhere (inside strings, numbers, literals or \u
+    // escapes), and finish() marks the end of the input. Events go to the same
+    // handlers as JsonReader, string views are always transient. Limits apply
+    // as in JsonReader, the document size counting every byte fed.
+    template <typename Handler>
+    class JsonPushReader
+    {
+    public:
+        explicit JsonPushReader(Handler & handler) : _handler(&handler) {}
+
+        bool feed(const char * data, size_t size);
+        bool finish();
+        void reset();
+
+        void set_limits(const JsonParseLimits & value) { _limits = value; }
+        const JsonParseLimits & get_limits() const { return _limits; }
+
+        bool done() const { return _state == State::Done; }
+        bool failed() const { return _state == State::Error; }
+        // JsonParseError of the failure and its description
+        int error() const { return _error_code; }
+        const char * error_message() const { return _error; }
+        // byte offset, 1-based line and column of the error
+        size_t error_offset() const { return _error_offset; }
+        size_t error_line() const { return _error_line; }
+        size_t error_column() const { return _error_column; }
+
+    private:
+        enum class State : uint8_t
+        {
+            Start,
+            Value,
+            ValueOrEndArray,
+            KeyOrEndObject,
+            Key,
+            Colon,
+            CommaOrEnd,
+            String,
+            Escape,
+            Number,
+            Literal,
+            Done,
+            Error,
+        };
+
+        struct Frame
+        {
+            bool is_object;
+            size_t count;
+        };
+
+        bool fail(const char * message, size_t offset, int error = JSON_ERROR_SYNTAX)
+        {
+            _state = State::Error;
+            _error_code = error;
+            _error = message;
+            _error_offset = offset;
+            _error_line = _line;
+            _error_column = offset - _line_start + 1;
+            return false;
+        }
+
+        bool fail(int error, size_t offset) { return fail(json_error_message(error), offset, error); }
+
+        bool count_node(size_t offset)
+        {
+            return ++_nodes <= _limits.max_nodes || fail(JSON_ERROR_NODE_COUNT, offset);
+        }
+
+        bool value_done()
+        {
+            if (_stack.empty())
+            {
+                _state = State::Done;
+                return true;
+            }
+            ++_stack.back().count;
+            _state = State::CommaOrEnd;
+            return true;
+        }
+
+        bool open(bool is_object, size_t offset)
+        {
+            if (_stack.size() >= _limits.max_depth)
+                return fail(JSON_ERROR_DEPTH, offset);
+            if (!(is_object ? _handler->on_start_object() : _handler->on_start_array()))
+                return fail("aborted by handler", offset, JSON_ERROR_HANDLER);
+            _stack.push_back(Frame{ is_object, 0 });
+            _state = is_object ? State::KeyOrEndObject : State::ValueOrEndArray;
+            return true;
+        }
+
+        bool close(char c, size_t offset)
+        {
+            if (_stack.empty() || _stack.back().is_object != (c == '}'))
+                return fail("mismatched closing bracket", offset);
+            size_t count = _stack.back().count;
+            _stack.pop_back();
+            if (!(c == '}' ? _handler->on_end_object(count) : _handler->on_end_array(count)))
+                return fail("aborted by handler", offset, JSON_ERROR_HANDLER);
+            return value_done();
+        }
+
+        bool begin_value(char c, size_t offset)
+        {
+            if (!count_node(offset))
+                return false;
+            switch (c)
+            {
+            case '{':
+                return open(true, offset);
+            case '[':
+                return open(false, offset);
+            case '\"':
+                _string_is_key = false;
+                _buffer.clear();
+                _state = State::String;
+                return true;
+            case 't':
+                _literal = "true";
+                break;
+            case 'f':
+                _literal = "false";
+                break;
+            case 'n':
+                _literal = "null";
+                break;
+            default:
+                if (c == '-' || (c >= '0' && c <= '9'))
+                {
+                    _token.assign(1, c);
+                    _state = State::Number;
+                    return true;
+                }
+                return fail("unexpected character", offset);
+            }
+            _literal_pos = 1;
+            _state = State::Literal;
+            return true;
+        }
+
+        bool finish_string(size_t offset)
+        {
+            if (_string_is_key)
+            {
+                if (!_handler->on_key(_key, false))
+                    return fail("aborted by handler", offset, JSON_ERROR_HANDLER);
+                _state = State::Colon;
+                return true;
+            }
+            if (!_handler->on_string(_buffer, false))
+                return fail("aborted by handler", offset, JSON_ERROR_HANDLER);
+            return value_done();
+        }
+
+        bool finish_number(size_t offset)
+        {
+            JsonNumberValue number;
+            const char * end = _token.data() + _token.size();
+            if (parse_number(_token.data(), end, number) != end)
+                return fail("invalid number", offset - _token.size());
+            if (!_handler->on_number(number, _token))
+                return fail("aborted by handler", offset, JSON_ERROR_HANDLER);
+            return value_done();
+        }
+
+        bool finish_literal(size_t offset)
+        {
+            bool ok = _literal[0] == 'n' ? _handler->on_null() : _handler->on_boolean(_literal[0] == 't');
+            if (!ok)
+                return fail("aborted by handler", offset, JSON_ERROR_HANDLER);
+            return value_done();
+        }
+
+        static bool is_number_char(char c)
+        {
+            return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+        }
+
+        Handler * _handler = nullptr;
+        JsonParseLimits _limits;
+        State _state = State::Start;
+        std::vector<Frame> _stack;
+        size_t _nodes = 0;
+
+        bool _string_is_key = false;
+        std::string _key;       // key of the current member
+        std::string _buffer;    // string value being decoded
+        std::string _escape;    // escape sequence collected across chunks
+        std::string _token;     // number text collected across chunks
+        const char * _literal = nullptr;
+        size_t _literal_pos = 0;
+        size_t _bom_pos = 0;
+
+        size_t _consumed = 0;
+        size_t _line = 1;
+        size_t _line_start = 0;
+
+        int _error_code = JSON_ERROR_NONE;
+        const char * _error = nullptr;
+        size_t _error_offset = 0;
+        size_t _error_line = 0;
+        size_t _error_column = 0;
+    };
+
+    template <typename Handler>
+    bool JsonPushReader<Handler>::feed(const char * data, size_t size)
+    {
+        if (_state == State::Error)
+            return false;
+        if (size > _limits.max_document_size - _consumed)
+            return fail(JSON_ERROR_DOCUMENT_SIZE, _consumed);
+
+        const char * p = data;
+        const char * end = data + size;
+        auto offset = [&]() { return _consumed + static_cast<size_t>(p - data); };
+
+        while (p < end)
+        {
+            switch (_state)
+            {
+            case State::String:
+            {
+                std::string & target = _string_is_key ? _key : _buffer;
+                const char * run = scan_string(p, end);
+                target.append(p, run - p);
+                p = run;
+                if (target.size() > _limits.max_string_length)
+                    return fail(JSON_ERROR_STRING_LENGTH, offset());
+                if (p == end)
+                    break;
+                if (*p++ == '\"')
+                {
+                    if (!finish_string(offset()))
+                        return false;
+                }
+                else
+                {
+                    _escape.assign(1, '\\');
+                    _state = State::Escape;
+                }
+                continue;
+            }
+            case State::Escape:
+            {
+                _escape.push_back(*p++);
+                int length = escape_length(_escape.data(), _escape.size());
+                if (length < 0)
+                    return fail("invalid escape sequence", offset());
+                if (length == 0)
+                    continue;
+                std::string & target = _string_is_key ? _key : _buffer;
+                if (!decode_escape(_escape.data(), _escape.data() + length, target))
+                    return fail("invalid escape sequence", offset());
+                if (target.size() > _limits.max_string_length)
+                    return fail(JSON_ERROR_STRING_LENGTH, offset());
+                _state = State::String;
+                continue;
+            }
+            case State::Number:
+            {
+                const char * run = p;
+                while (p < end && is_number_char(*p))
+                    ++p;
+                _token.append(run, p - run);
+                if (p == end)
+                    break;
+                if (!finish_number(offset()))
+                    return false;
+                continue;
+            }
+            case State::Literal:
+            {
+                if (*p != _literal[_literal_pos])
+                    return fail("invalid literal", offset());
+                ++p;
+                if (_literal[++_literal_pos] == '\0' && !finish_literal(offset()))
+                    return false;
+                continue;
+            }
+            default:
+                break;
+            }
+
+            if (p == end)
+                break;
+
+            char c = *p;
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+            {
+                if (c == '\n')
+                {
+                    ++_line;
+                    _line_start = offset() + 1;
+                }
+                ++p;
+                continue;
+            }
+
+            size_t at = offset();
+            ++p;
+            switch (_state)
+            {
+            case State::Start:
+            {
+                static const unsigned char bom[] = { 0xEF, 0xBB, 0xBF };
+
+                // UTF-8 BOM, possibly split across chunks
+                if (at == _bom_pos && at < 3 && static_cast<unsigned char>(c) == bom[at])
+                {
+                    ++_bom_pos;
+                    continue;
+                }
+                if (_bom_pos > 0 && _bom_pos < 3)
+                    return fail("incomplete UTF-8 BOM", at);
+                if (c != '{' && c != '[')
+                    return fail("document must start with an object or array", at);
+                if (!count_node(at) || !open(c == '{', at))
+                    return false;
+                break;
+            }
+            case State::Value:
+                if (!begin_value(c, at))
+                    return false;
+                break;
+            case State::ValueOrEndArray:
+                if (c == ']' ? !close(c, at) : !begin_value(c, at))
+                    return false;
+                break;
+            case State::KeyOrEndObject:
+            case State::Key:
+                if (c == '}' && _state == State::KeyOrEndObject)
+                {
+                    if (!close(c, at))
+                        return false;
+                    break;
+                }
+                if (c != '\"')
+                    return fail("expected a key", at);
+                _string_is_key = true;
+                _key.clear();
+                _state = State::String;
+                break;
+            case State::Colon:
+                if (c != ':')
+                    return fail("expected ':'", at);
+                _state = State::Value;
+                break;
+            case State::CommaOrEnd:
+                if (c == ',')
+                    _state = _stack.back().is_object ? State::Key : State::Value;
+                else if (c == '}' || c == ']')
+                {
+                    if (!close(c, at))
+                        return false;
+                }
+                else
+                    return fail("expected ',' or a closing bracket", at);
+                break;
+            case State::Done:
+                return fail("unexpected data after the document", at);
+            default:
+                return fail("invalid parser state", at);
+            }
+        }
+
+        _consumed += size;
+        return true;
+    }
+
+    template <typename Handler>
+    bool JsonPushReader<Handler>::finish()
+    {
+        if (_state == State::Number && !finish_number(_consumed))
+            return false;
+        if (_state == State::Error)
+            return false;
+        if (_state != State::Done)
+            return fail("unexpected end of input", _consumed);
+        return true;
+    }
+
+    template <typename Handler>
+    void JsonPushReader<Handler>::reset()
+    {
+        _state = State::Start;
+        _stack.clear();
+        _nodes = 0;
+        _key.clear();
+        _buffer.clear();
+        _escape.clear();
+        _token.clear();
+        _literal = nullptr;
+        _literal_pos = 0;
+        _bom_pos = 0;
+        _consumed = 0;
+        _line = 1;
+        _line_start = 0;
+        _error_code = JSON_ERROR_NONE;
+        _error = nullptr;
+        _error_offset = _error_line = _error_column = 0;
+    }
+
+    class JsonDomBuilder;
+
+    // Push parser building a JsonDocument. Strings are always copied into the
+    // document since the chunks do not outlive feed(). The document limits
+    // are taken on construction and reset().
+    class JsonPushParser
+    {
+    public:
+        explicit JsonPushParser(JsonDocument & document, uint32_t flags = JSON_PARSE_DEFAULT);
+        ~JsonPushParser();
+
+        JsonPushParser(const JsonPushParser &) = delete;
+        JsonPushParser & operator=(const JsonPushParser &) = delete;
+
+        bool feed(const char * data, size_t size);
+        bool feed(std::string_view data) { return feed(data.data(), data.size()); }
+        // the root once the input is complete and valid, nullptr otherwise
+        JsonAny * finish();
+        // clears the document and starts over
+        void reset();
+
+        // JsonParseError of a failed feed() / finish()
+        int error() const;
+        const char * error_message() const;
+        size_t error_offset() const;
+        size_t error_line() const;
+        size_t error_column() const;
+
+    private:
+        JsonDocument & _document;
+        uint32_t _flags = 0;
+        std::unique_ptr<JsonDomBuilder> _builder;
+        std::unique_ptr<JsonPushReader<JsonDomBuilder>> _reader;
+    };
+} // namespace easy_json
@@ -0,0 +1,638 @@
+﻿#pragma once
+#include "easy_json.h"
+#include "easy_json_stats.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace easy_json {
+    struct JsonNumberValue
+    {
+        JsonNumberType type = JsonNumberType::Double;
+        union
+        {
+            int64_t i;
+            uint64_t u;
+            double d;
+        };
+    };
+
+    // Parses one JSON number from [p, end) without touching the locale.
+    // Integers that fit are kept exact as int64 / uint64, everything else is a
+    // correctly rounded double. Returns the end of the number or nullptr when
+    // the text is not a valid JSON number.
+    const char * parse_number(const char * p, const char * end, JsonNumberValue & value);
+
+    // Returns the first '"' or '\\' in [p, end), or end. Backed by AVX2, SSE2
+    // or SWAR, picked once at startup from the CPU features.
+    const char * scan_string(const char * p, const char * end);
+
+    // name of the scanner picked at startup, for diagnostics
+    const char * scan_string_impl();
+
+    // Stage one of JSON_PARSE_STRUCTURAL_INDEX. Yields the offsets of every
+    // operator and of the first byte of every string, number and literal
+    // outside of strings, ascending, one window at a time so the positions
+    // stay in cache while the parser walks them. Inputs are limited to 4GB.
+    class JsonStructuralIndexer
+    {
+    public:
+        enum : size_t
+        {
+            MIN_CAPACITY = 64,    // room for one 64 byte block
+        };
+
+        // carried from one 64 byte block to the next
+        struct State
+        {
+            uint64_t escape_carry = 0;    // first byte of the block is escaped
+            uint64_t in_string = 0;       // all ones while inside a string
+            uint64_t scalar_carry = 0;    // last byte was part of a bare scalar
+        };
+
+        JsonStructuralIndexer(const char * data, size_t size);
+
+        // indexes the following blocks into positions, entries past the
+        // returned count may be scribbled over. Returns 0 once the input is
+        // exhausted or when capacity is below MIN_CAPACITY.
+        size_t next(uint32_t * positions, size_t capacity);
+        bool done() const { return _offset >= _size; }
+
+    private:
+        const char * _data;
+        size_t _size;
+        size_t _offset = 0;
+        State _state;
+    };
+
+    // "avx2", "sse2", "neon" or "scalar", picked at startup from the CPU
+    const char * structural_index_impl();
+    // forces one of the above, false when it is not available on this CPU.
+    // Not synchronized with running parses.
+    bool select_structural_index_impl(const char * name);
+
+    inline int hex_to_value(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 0xA;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 0xA;
+        return 0xFF;
+    }
+
+    // the four hex digits at p, -1 when one is not
+    inline int32_t read_hex4(const char * p)
+    {
+        int32_t value = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            int v = hex_to_value(p[i]);
+            if (v == 0xFF)
+                return -1;
+            value = (value << 4) | v;
+        }
+        return value;
+    }
+
+    // Length of the escape sequence at p (the backslash) when size bytes
+    // hold all of it, 0 while more are needed and -1 when it is invalid.
+    // A high surrogate takes the \u escape of a low one with it, a lone
+    // surrogate is invalid. Shared by the readers so they agree on it.
+    inline int escape_length(const char * p, size_t size)
+    {
+        if (size < 2)
+            return 0;
+        switch (p[1])
+        {
+        case '\"':
+        case '\\':
+        case '/':
+        case 'b':
+        case 'f':
+        case 'n':
+        case 'r':
+        case 't':
+            return 2;
+        case 'u':
+            break;
+        default:
+            return -1;
+        }
+        if (size < 6)
+            return 0;
+
+        int32_t high = read_hex4(p + 2);
+        if (high < 0 || (high & 0xFC00) == 0xDC00)
+            return -1;
+        if ((high & 0xFC00) != 0xD800)
+            return 6;
+        if ((size >= 7 && p[6] != '\\') || (size >= 8 && p[7] != 'u'))
+            return -1;
+        if (size < 12)
+            return 0;
+        return (read_hex4(p + 8) & 0xFC00) == 0xDC00 ? 12 : -1;
+    }
+
+    // Decodes the escape sequence at p (the backslash) into out as UTF-8.
+    // Returns the position after it, nullptr when it is invalid.
+    inline const char * decode_escape(const char * p, const char * end, std::string & value)
+    {
+        int length = escape_length(p, end - p);
+        if (length <= 0)
+            return nullptr;
+
+        switch (p[1])
+        {
+        case 'b':
+            value.push_back('\b');
+            return p + 2;
+        case 'f':
+            value.push_back('\f');
+            return p + 2;
+        case 'n':
+            value.push_back('\n');
+            return p + 2;
+        case 'r':
+            value.push_back('\r');
+            return p + 2;
+        case 't':
+            value.push_back('\t');
+            return p + 2;
+        case 'u':
+            break;
+        default:
+            value.push_back(p[1]);
+            return p + 2;
+        }
+
+        uint32_t uchar = static_cast<uint32_t>(read_hex4(p + 2));
+        if (length == 12)
+            uchar = 0x010000 + ((uchar & 0x3FF) << 10) + (static_cast<uint32_t>(read_hex4(p + 8)) & 0x3FF);
+
+        if (uchar <= 0x7F)
+        {
+            value += static_cast<char>(uchar & 0XFF);
+        }
+        else if (uchar <= 0x7FF)
+        {
+            value += static_cast<char>(0XC0 | (uchar >> 6));
+            value += static_cast<char>(0X80 | (uchar & 0X3F));
+        }
+        else if (uchar <= 0xFFFF)
+        {
+            value += static_cast<char>(0XE0 | (uchar >> 12));
+            value += static_cast<char>(0X80 | ((uchar >> 6) & 0x3F));
+            value += static_cast<char>(0X80 | (uchar & 0X3F));
+        }
+        else
+        {
+            value += static_cast<char>(0XF0 | (uchar >> 18));
+            value += static_cast<char>(0X80 | ((uchar >> 12) & 0x3F));
+            value += static_cast<char>(0X80 | ((uchar >> 6) & 0x3F));
+            value += static_cast<char>(0X80 | (uchar & 0X3F));
+        }
+        return p + length;
+    }
+
+    // Callbacks of JsonReader, every one returns false to stop parsing.
+    // String views are only valid during the call unless `stable` is set, in
+    // which case they point into the input (JSON_PARSE_BORROW_INPUT / in-situ).
+    // Derive from it and hide the callbacks you need, calls are resolved
+    // statically and can be inlined.
+    struct JsonBaseHandler
+    {
+        bool on_null() { return true; }
+        bool on_boolean(bool) { return true; }
+        // text is the number as written in the input
+        bool on_number(const JsonNumberValue &, std::string_view) { return true; }
+        bool on_string(std::string_view, bool) { return true; }
+        bool on_start_object() { return true; }
+        bool on_key(std::string_view, bool) { return true; }
+        bool on_end_object(size_t) { return true; }
+        bool on_start_array() { return true; }
+        bool on_end_array(size_t) { return true; }
+    };
+
+    // Event parser driving a Handler, the DOM parser is one such handler.
+    template <typename Handler>
+    class JsonReader
+    {
+#define EASY_JSON_RETURN_ERROR(code) { err = code; return false; }
+
+    public:
+        JsonReader(const char * json_string, size_t str_len, uint32_t flags = JSON_PARSE_DEFAULT)
+        {
+            str_start = json_string;
+            str_end = str_start + str_len;
+            flag = flags;
+        }
+
+        // escaped strings are decoded in place, every string handed out is stable
+        JsonReader(char * buffer, size_t str_len)
+            : JsonReader(buffer, str_len, JSON_PARSE_BORROW_INPUT)
+        {
+            in_situ_start = buffer;
+        }
+
+        // points the reader at new input, buffers and the container stack keep
+        // their capacity so a warm reader parses without allocating
+        void reset(const char * json_string, size_t str_len, uint32_t flags = JSON_PARSE_DEFAULT)
+        {
+            str_start = json_string;
+            str_end = str_start + str_len;
+            p = str_start;
+            flag = flags;
+            in_situ_start = nullptr;
+        }
+
+        void reset_in_situ(char * buffer, size_t str_len)
+        {
+            reset(buffer, str_len, JSON_PARSE_BORROW_INPUT);
+            in_situ_start = buffer;
+        }
+
+        // bytes held by the reusable buffers
+        size_t buffer_capacity() const
+        {
+            return stack.capacity() * sizeof(Frame) + key_buffer.capacity() + value_buffer.capacity() +
+                   (structurals ? STRUCTURAL_WINDOW * sizeof(uint32_t) : 0);
+        }
+
+        // bounds for untrusted input, JsonParseLimits() by default
+        void set_limits(const JsonParseLimits & value) { limits = value; }
+        const JsonParseLimits & get_limits() const { return limits; }
+
+        bool parse(Handler & h)
+        {
+            handler = &h;
+            p = str_start;
+            err = JSON_ERROR_NONE;
+            if (static_cast<size_t>(str_end - str_start) > limits.max_document_size)
+                EASY_JSON_RETURN_ERROR(JSON_ERROR_DOCUMENT_SIZE)
+            if (str_end - str_start >= 3 &&
+                static_cast<unsigned char>(str_start[0]) == 0XEF &&
+                static_cast<unsigned char>(str_start[1]) == 0XBB &&
+                static_cast<unsigned char>(str_start[2]) == 0XBF) // UTF-8 BOM
+                p += 3;
+
+            EASY_JSON_STAT(stats = JsonParseStats());
+            indexed = false;
+            structural_count = 0;
+            structural_cursor = 0;
+            if ((flag & JSON_PARSE_STRUCTURAL_INDEX) && static_cast<size_t>(str_end - str_start) <= UINT32_MAX)
+            {
+                if (!structurals)
+                    structurals.reset(new uint32_t[STRUCTURAL_WINDOW]);
+                indexer = JsonStructuralIndexer(str_start, str_end - str_start);
+                indexed = true;
+                next_structurals();
+            }
+
+            char c = skip_space();
+            if (c != '{' && c != '[')
+                EASY_JSON_RETURN_ERROR(JSON_ERROR_SYNTAX)
+            bool ok = parse_document();
+            // only blanks may follow the root, p is left on anything else
+            if (ok && (skip_space() != '\0' || p < str_end))
+            {
+                err = JSON_ERROR_SYNTAX;
+                ok = false;
+            }
+            EASY_JSON_STAT(stats.bytes = p - str_start);
+            EASY_JSON_STAT(stats.ok = ok);
+            return ok;
+        }
+
+        // JsonParseError of the last parse
+        int error() const { return err; }
+        // position where parsing stopped
+        size_t offset() const { return p - str_start; }
+#if EASY_JSON_STATS
+        // node counts, depth and escapes of the last parse
+        const JsonParseStats & statistics() const { return stats; }
+#endif
+
+    private:
+        const char * str_start = nullptr;
+        const char * str_end = nullptr;
+        const char * p = nullptr;
+        char * in_situ_start = nullptr;    // writable alias of str_start in in-situ mode
+
+        uint32_t flag = 0;
+        Handler * handler = nullptr;
+        int err = JSON_ERROR_NONE;
+        JsonParseLimits limits;
+
+        // open containers, the capacity is kept across parses
+        struct Frame
+        {
+            bool is_object;
+            size_t count;
+        };
+        std::vector<Frame> stack;
+        size_t nodes = 0;
+
+        // decode buffers for escaped keys and values, reused across strings
+        std::string key_buffer;
+        std::string value_buffer;
+
+        // JSON_PARSE_STRUCTURAL_INDEX: current window of positions
+        enum : size_t { STRUCTURAL_WINDOW = 4096 };
+        JsonStructuralIndexer indexer{ nullptr, 0 };
+        bool indexed = false;
+        std::unique_ptr<uint32_t[]> structurals;
+        size_t structural_count = 0;
+        size_t structural_cursor = 0;
+
+#if EASY_JSON_STATS
+        JsonParseStats stats;
+#endif
+
+        void next_structurals()
+        {
+            EASY_JSON_STAT(uint64_t start = stats_clock_ns());
+            structural_count = indexer.next(structurals.get(), STRUCTURAL_WINDOW);
+            structural_cursor = 0;
+            EASY_JSON_STAT(stats.index_ns += stats_clock_ns() - start);
+        }
+
+        char skip_space()
+        {
+            if (indexed)
+                return skip_to_structural();
+            while (p < str_end)
+            {
+                if (*p == ' ' || *p == '\r' || *p == '\n' || *p == '\t')
+                {
+                    ++p;
+                    continue;
+                }
+                return *p;
+            }
+            return '\0';
+        }
+
+        // Outside of strings the first non blank byte after a blank is always
+        // structural, so a blank run is skipped by jumping to the next indexed
+        // position. Bytes glued to the previous token are returned as is for
+        // the caller to reject.
+        char skip_to_structural()
+        {
+            if (p >= str_end)
+                return '\0';
+            char c = *p;
+            if (c != ' ' && c != '\r' && c != '\n' && c != '\t')
+                return c;
+
+            size_t offset = p - str_start;
+            while (true)
+            {
+                while (structural_cursor < structural_count && structurals[structural_cursor] < offset)
+                    ++structural_cursor;
+                if (structural_cursor < structural_count)
+                    break;
+                next_structurals();
+                if (structural_count == 0)
+                {
+                    p = str_end;
+                    return '\0';
+                }
+            }
+            p = str_start + structurals[structural_cursor];
+            return *p;
+        }
+
+        bool parse_escape_character(std::string & value)
+        {
+            const char * next = decode_escape(p, str_end, value);
+            if (next == nullptr)
+                return false;
+            p = next;
+            EASY_JSON_STAT(++stats.escapes);
+            return true;
+        }
+
+        // Strings without escapes come back as a view of the input. Escaped
+        // strings are decoded into buffer, or back into the input in in-situ mode.
+        bool parse_string(std::string_view & value, bool & stable, std::string & buffer)
+        {
+            const char * begin = ++p;
+            const char * run_end = scan_string(p, str_end);
+            if (run_end < str_end && *run_end == '\"')
+            {
+                if (static_cast<size_t>(run_end - begin) > limits.max_string_length)
+                    EASY_JSON_RETURN_ERROR(JSON_ERROR_STRING_LENGTH)
+                value = std::string_view(begin, run_end - begin);
+                stable = (flag & JSON_PARSE_BORROW_INPUT) != 0;
+                p = run_end + 1;
+                return true;
+            }
+
+            buffer.assign(begin, run_end - begin);
+            p = run_end;
+            while (true)
+            {
+                if (buffer.size() > limits.max_string_length)
+                    EASY_JSON_RETURN_ERROR(JSON_ERROR_STRING_LENGTH)
+                if (p >= str_end)
+                    EASY_JSON_RETURN_ERROR(JSON_ERROR_SYNTAX)
+                if (*p == '\"')
+                    break;
+                if (!parse_escape_character(buffer))
+                    EASY_JSON_RETURN_ERROR(JSON_ERROR_SYNTAX)
+
+                // copy the clean run up to the next quote or backslash in one go
+                run_end = scan_string(p, str_end);
+                buffer.append(p, run_end - p);
+                p = run_end;
+            }
+            ++p;
+
+            if (in_situ_start)
+            {
+                // decoded text is never longer than its escaped source
+                char * dst = in_situ_start + (begin - str_start);
+                memcpy(dst, buffer.data(), buffer.size());
+                value = std::string_view(dst, buffer.size());
+                stable = true;
+            }
+            else
+            {
+                value = buffer;
+                stable = false;
+            }
+            return true;
+        }
+
+        bool open_container(bool is_object)
+        {
+            if (stack.size() >= limits.max_depth)
+                EASY_JSON_RETURN_ERROR(JSON_ERROR_DEPTH)
+            if (!(is_object ? handler->on_start_object() : handler->on_start_array()))
+                EASY_JSON_RETURN_ERROR(JSON_ERROR_HANDLER)
+            ++p;
+            stack.push_back(Frame{ is_object, 0 });
+            EASY_JSON_STAT(++(is_object ? stats.objects : stats.arrays));
+            EASY_JSON_STAT(stats.max_depth = std::max<uint32_t>(stats.max_depth, static_cast<uint32_t>(stack.size())));
+            return true;
+        }
+
+        // "key" and the colon, p is left on the member value
+        bool parse_key()
+        {
+            std::string_view key;
+            bool stable = false;
+            if (skip_space() != '\"')
+                EASY_JSON_RETURN_ERROR(JSON_ERROR_SYNTAX)
+            if (!parse_string(key, stable, key_buffer))
+                return false;
+            if (skip_space() != ':')
+                EASY_JSON_RETURN_ERROR(JSON_ERROR_SYNTAX)
+            if (!handler->on_key(key, stable))
+                EASY_JSON_RETURN_ERROR(JSON_ERROR_HANDLER)
+            EASY_JSON_STAT(++stats.keys);
+            ++p;
+            return true;
+        }
+
+        bool parse_literal(const char * literal, size_t size)
+        {
+            if (static_cast<size_t>(str_end - p) < size || 0 != memcmp(p, literal, size))
+                EASY_JSON_RETURN_ERROR(JSON_ERROR_SYNTAX)
+            p += size;
+            return true;
+        }
+
+        bool parse_number()
+        {
+            JsonNumberValue number;
+            const char * num_str_end = easy_json::parse_number(p, str_end, number);
+            if (num_str_end == nullptr)
+                EASY_JSON_RETURN_ERROR(JSON_ERROR_SYNTAX)
+
+            std::string_view text(p, num_str_end - p);
+            p = num_str_end;
+            EASY_JSON_STAT(++stats.numbers);
+            if (!handler->on_number(number, text))
+                EASY_JSON_RETURN_ERROR(JSON_ERROR_HANDLER)
+            return true;
+        }
+
+        bool parse_scalar(char c)
+        {
+            bool ok = true;
+            switch (c)
+            {
+            case '\"':
+            {
+                std::string_view str;
+                bool stable = false;
+                if (!parse_string(str, stable, value_buffer))
+                    return false;
+                EASY_JSON_STAT(++stats.strings);
+                ok = handler->on_string(str, stable);
+                break;
+            }
+            case 't':
+                if (!parse_literal("true", 4))
+                    return false;
+                EASY_JSON_STAT(++stats.booleans);
+                ok = handler->on_boolean(true);
+                break;
+            case 'f':
+                if (!parse_literal("false", 5))
+                    return false;
+                EASY_JSON_STAT(++stats.booleans);
+                ok = handler->on_boolean(false);
+                break;
+            case 'n':
+                if (!parse_literal("null", 4))
+                    return false;
+                EASY_JSON_STAT(++stats.nulls);
+                ok = handler->on_null();
+                break;
+            default:
+                return parse_number();
+            }
+            if (!ok)
+                EASY_JSON_RETURN_ERROR(JSON_ERROR_HANDLER)
+            return true;
+        }
+
+        // Iterative: open containers live on `stack` instead of the call
+        // stack, so nesting costs one Frame per level up to limits.max_depth.
+        bool parse_document()
+        {
+            stack.clear();
+            if (stack.capacity() == 0)
+                stack.reserve(32);
+            nodes = 0;
+            char c = skip_space();
+            while (true)
+            {
+                if (++nodes > limits.max_nodes)
+                    EASY_JSON_RETURN_ERROR(JSON_ERROR_NODE_COUNT)
+
+                if (c == '{' || c == '[')
+                {
+                    bool is_object = c == '{';
+                    if (!open_container(is_object))
+                        return false;
+                    c = skip_space();
+                    if (c != (is_object ? '}' : ']'))
+                    {
+                        // first member, an empty container is closed below
+                        if (is_object && !parse_key())
+                            return false;
+                        c = skip_space();
+                        continue;
+                    }
+                }
+                else
+                {
+                    if (!parse_scalar(c))
+                        return false;
+                    if (!stack.empty())
+                        ++stack.back().count;
+                }
+
+                // the value is complete: close the containers it completes
+                // and move on to the next member
+                while (true)
+                {
+                    if (stack.empty())
+                        return true;
+
+                    Frame & top = stack.back();
+                    c = skip_space();
+                    if (c == ',')
+                    {
+                        ++p;
+                        if (top.is_object && !parse_key())
+                            return false;
+                        c = skip_space();
+                        break;
+                    }
+                    if (c != (top.is_object ? '}' : ']'))
+                        EASY_JSON_RETURN_ERROR(JSON_ERROR_SYNTAX)
+
+                    ++p;
+                    Frame closed = top;
+                    stack.pop_back();
+                    if (!(closed.is_object ? handler->on_end_object(closed.count) : handler->on_end_array(closed.count)))
+                        EASY_JSON_RETURN_ERROR(JSON_ERROR_HANDLER)
+                    if (!stack.empty())
+                        ++stack.back().count;
+                }
+            }
+        }
+
+#undef EASY_JSON_RETURN_ERROR
+    };
+} // namespace easy_json
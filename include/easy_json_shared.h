@@ -0,0 +1,42 @@
+﻿#pragma once
+#include "easy_json.h"
+
+#include <atomic>
+#include <memory>
+
+namespace easy_json {
+    // RCU style cell holding the current version of a frozen document.
+    // Readers take a snapshot with load() and read it for as long as they
+    // like, a writer publishes a replacement with store(). The previous
+    // version is freed by whoever drops its last snapshot, readers never wait
+    // for writers beyond the pointer swap.
+    class JsonSharedDocument
+    {
+    public:
+        JsonSharedDocument() = default;
+        explicit JsonSharedDocument(std::shared_ptr<JsonDocument> document) { store(std::move(document)); }
+
+        JsonSharedDocument(const JsonSharedDocument &) = delete;
+        JsonSharedDocument & operator=(const JsonSharedDocument &) = delete;
+
+        std::shared_ptr<const JsonDocument> load() const
+        {
+            return std::atomic_load_explicit(&_current, std::memory_order_acquire);
+        }
+
+        // freezes document before publishing it
+        void store(std::shared_ptr<JsonDocument> document) { exchange(std::move(document)); }
+
+        // publishes document and returns the version it replaces
+        std::shared_ptr<const JsonDocument> exchange(std::shared_ptr<JsonDocument> document)
+        {
+            if (document)
+                document->freeze();
+            return std::atomic_exchange_explicit(&_current, std::shared_ptr<const JsonDocument>(std::move(document)),
+                                                 std::memory_order_acq_rel);
+        }
+
+    private:
+        std::shared_ptr<const JsonDocument> _current;
+    };
+} // namespace easy_json
@@ -0,0 +1,71 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Parse / write statistics. They are collected only when the library and its
+// users are built with EASY_JSON_STATS=1 (cmake -DEASY_JSON_ENABLE_STATS=ON),
+// otherwise every counter compiles to nothing.
+#ifndef EASY_JSON_STATS
+#define EASY_JSON_STATS 0
+#endif
+
+#if EASY_JSON_STATS
+#include <chrono>
+#define EASY_JSON_STAT(statement) statement
+#else
+#define EASY_JSON_STAT(statement)
+#endif
+
+namespace easy_json {
+    constexpr bool JSON_STATS_ENABLED = EASY_JSON_STATS != 0;
+
+    struct JsonParseStats
+    {
+        uint64_t bytes = 0;             // input consumed
+        uint64_t objects = 0;
+        uint64_t arrays = 0;
+        uint64_t strings = 0;
+        uint64_t numbers = 0;
+        uint64_t booleans = 0;
+        uint64_t nulls = 0;
+        uint64_t keys = 0;
+        uint32_t max_depth = 0;
+        uint64_t escapes = 0;           // escape sequences decoded
+        uint64_t allocations = 0;       // arena blocks requested upstream
+        uint64_t bytes_allocated = 0;
+        uint64_t map_ns = 0;            // file mapping, parse_file only
+        uint64_t index_ns = 0;          // structural indexing, part of parse_ns
+        uint64_t parse_ns = 0;
+        bool ok = false;
+    };
+
+    struct JsonWriteStats
+    {
+        uint64_t bytes = 0;
+        uint64_t values = 0;
+        uint64_t escapes = 0;           // characters written as escape sequences
+        uint64_t write_ns = 0;
+    };
+
+    // Called on the parsing / writing thread after JsonDocument and JsonAny
+    // parses and JsonAny::dump(), keep them short
+    struct JsonStatsHooks
+    {
+        void (*on_parse)(const JsonParseStats & stats, void * user) = nullptr;
+        void (*on_write)(const JsonWriteStats & stats, void * user) = nullptr;
+        void * user = nullptr;
+    };
+
+    // installs hooks for all threads, hooks must outlive their installation.
+    // nullptr removes them. Without EASY_JSON_STATS hooks are never called.
+    void set_stats_hooks(const JsonStatsHooks * hooks);
+    const JsonStatsHooks * stats_hooks();
+
+#if EASY_JSON_STATS
+    inline uint64_t stats_clock_ns()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+#endif
+} // namespace easy_json
@@ -0,0 +1,66 @@
+﻿#pragma once
+#include "easy_json_push.h"
+#include "easy_json_writer.h"
+
+#include <cstdio>
+#include <memory>
+#include <string_view>
+
+namespace easy_json {
+    struct JsonTranscodeOptions
+    {
+        int indent = 0;                 // spaces per level, 0 writes compact text
+        bool escape_unicode = false;    // non-ASCII as \u escapes instead of raw UTF-8
+        // members of every object in byte order of their keys. An object is
+        // held until it closes, one larger than sort_buffer bytes fails. The
+        // buffer is capped just below 4 GiB.
+        bool sort_keys = false;
+        size_t sort_buffer = 16 << 20;
+        // for every input path, whole buffers and fed pieces alike
+        JsonParseLimits limits;
+    };
+
+    class JsonTranscodeHandler;
+
+    // Rewrites JSON text without building a tree: reader events go straight
+    // to a JsonWriter on the sink and numbers keep their source text. Memory
+    // is bounded by the nesting depth, plus sort_buffer when sorting keys.
+    // The output is flushed to the sink when a document ends.
+    class JsonTranscoder
+    {
+    public:
+        explicit JsonTranscoder(JsonSink & sink, const JsonTranscodeOptions & options = JsonTranscodeOptions());
+        ~JsonTranscoder();
+
+        JsonTranscoder(const JsonTranscoder &) = delete;
+        JsonTranscoder & operator=(const JsonTranscoder &) = delete;
+
+        // one whole document
+        bool transcode(const char * data, size_t size);
+        bool transcode(std::string_view data) { return transcode(data.data(), data.size()); }
+        // reads file until EOF in fixed size chunks, for pipes and stdin
+        bool transcode(FILE * file);
+        // memory mapped like JsonDocument::parse_file
+        bool transcode_file(const char * path);
+
+        // a document split in pieces, then finish()
+        bool feed(const char * data, size_t size);
+        bool finish();
+        // drops a partial document, output already handed to the sink stays
+        void reset();
+
+        // set when a call above returned false
+        const char * error_message() const;
+        size_t error_offset() const { return _error_offset; }
+
+    private:
+        bool fail(const char * message, size_t offset);
+
+        std::unique_ptr<JsonWriter> _writer;
+        std::unique_ptr<JsonTranscodeHandler> _handler;
+        std::unique_ptr<JsonPushReader<JsonTranscodeHandler>> _reader;
+        JsonParseLimits _limits;
+        const char * _error = nullptr;
+        size_t _error_offset = 0;
+    };
+} // namespace easy_json
@@ -0,0 +1,144 @@
+﻿#pragma once
+#include "easy_json.h"
+#include "easy_json_stats.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace easy_json {
+    // destination of serialized text, written in large chunks by JsonWriter
+    class JsonSink
+    {
+    public:
+        virtual ~JsonSink() = default;
+        virtual bool write(const char * data, size_t size) = 0;
+    };
+
+    class JsonStringSink : public JsonSink
+    {
+    public:
+        explicit JsonStringSink(std::string & out) : _out(out) {}
+        virtual bool write(const char * data, size_t size) override
+        {
+            _out.append(data, size);
+            return true;
+        }
+
+    private:
+        std::string & _out;
+    };
+
+    class JsonFileSink : public JsonSink
+    {
+    public:
+        explicit JsonFileSink(FILE * file) : _file(file) {}
+        virtual bool write(const char * data, size_t size) override;
+
+    private:
+        FILE * _file = nullptr;
+    };
+
+    class JsonFdSink : public JsonSink
+    {
+    public:
+        explicit JsonFdSink(int fd) : _fd(fd) {}
+        virtual bool write(const char * data, size_t size) override;
+
+    private:
+        int _fd = -1;
+    };
+
+    // Serializes a tree in one pass into a single buffer. Writing to a
+    // std::string fills the string directly, other sinks get the buffer each
+    // time it fills up. The begin/end/key/value calls build documents without
+    // a tree, the writer inserts the separators.
+    class JsonWriter
+    {
+    public:
+        explicit JsonWriter(std::string & out, size_t reserve = 4096);
+        explicit JsonWriter(JsonSink & sink, size_t buffer_size = 64 * 1024);
+        ~JsonWriter();
+
+        JsonWriter(const JsonWriter &) = delete;
+        JsonWriter & operator=(const JsonWriter &) = delete;
+
+        bool write(const JsonAny * value);
+
+        // spaces per nesting level, every value on its own line. 0, the
+        // default, writes compact text.
+        void set_indent(int spaces) { _indent = spaces > 0 ? spaces : 0; }
+        // characters beyond ASCII as \u escapes (surrogate pairs above the BMP)
+        // instead of raw UTF-8, malformed UTF-8 becomes \ufffd
+        void set_escape_unicode(bool enable) { _escape_unicode = enable; }
+
+        void begin_object();
+        void end_object();
+        void begin_array();
+        void end_array();
+        void key(std::string_view name);
+        void string(std::string_view value);
+        void integer(int64_t value);
+        void unsigned_integer(uint64_t value);
+        void number(double value);
+        void raw_number(std::string_view text);
+        void boolean(bool value);
+        void null();
+
+        // hands buffered text to the sink, or trims the target string
+        bool flush();
+        // drops text not flushed yet and any open containers
+        void reset();
+        bool ok() const { return _ok; }
+        size_t bytes_written() const { return _total + _len; }
+#if EASY_JSON_STATS
+        // values and escapes written so far, bytes and time are left to the caller
+        const JsonWriteStats & statistics() const { return _stats; }
+#endif
+
+    private:
+        void write_value(const JsonAny * value);
+        void separator();
+        void new_line();
+        void close_container(char c);
+        void write_escaped(std::string_view value);
+        const char * write_unicode_escape(const char * p, const char * end);
+
+        void put(char c)
+        {
+            if (_len == _cap)
+                make_room(1);
+            _buf[_len++] = c;
+        }
+
+        void put(const char * data, size_t size)
+        {
+            if (_cap - _len < size)
+                make_room(size);
+            memcpy(_buf + _len, data, size);
+            _len += size;
+        }
+
+        void make_room(size_t size);
+
+        std::string * _target = nullptr;
+        JsonSink * _sink = nullptr;
+        std::vector<char> _storage;
+        char * _buf = nullptr;
+        size_t _cap = 0;
+        size_t _len = 0;
+        size_t _total = 0;
+        bool _ok = true;
+
+        // one entry per open container: whether a value was already written
+        std::vector<uint8_t> _has_value;
+        bool _after_key = false;
+        int _indent = 0;
+        bool _escape_unicode = false;
+#if EASY_JSON_STATS
+        JsonWriteStats _stats;
+#endif
+    };
+} // namespace easy_json
@@ -1,8 +1,17 @@
 ﻿#include "easy_json.h"
-
-#include <fstream>
-#include <sstream>
+#include "easy_json_writer.h"
+#include "easy_json_number.h"
+#include "easy_json_dom.h"
+#include "easy_json_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 namespace easy_json
 {
@@ -21,7 +30,9 @@ namespace easy_json
             if (_need_free_ptr == nullptr || *_need_free_ptr == nullptr)
                 return;
 
-            if (!_is_array)
+            if constexpr (std::is_base_of_v<JsonAny, T>)
+                JsonAny::destroy(*_need_free_ptr);
+            else if (!_is_array)
                 delete * _need_free_ptr;
             else
                 delete[] * _need_free_ptr;
@@ -38,187 +49,812 @@ namespace easy_json
 #define AutoFreeArray(className, instance) \
     AutoFree<className> _auto_free_array_##instance(&instance, true)
 
-    // tools func
-    std::string escape(std::string && v)
+    const char * json_error_message(int error)
     {
-        std::stringstream ss;
-        for (auto & c : v)
+        switch (error)
         {
-            if (c == '"')
-                ss << '\\';
-            ss << c;
+        case JSON_ERROR_NONE:
+            return "no error";
+        case JSON_ERROR_SYNTAX:
+            return "syntax error";
+        case JSON_ERROR_HANDLER:
+            return "stopped by handler";
+        case JSON_ERROR_DEPTH:
+            return "nesting too deep";
+        case JSON_ERROR_DOCUMENT_SIZE:
+            return "document too large";
+        case JSON_ERROR_STRING_LENGTH:
+            return "string too long";
+        case JSON_ERROR_NODE_COUNT:
+            return "too many values";
+        case JSON_ERROR_FILE:
+            return "file not readable";
+        default:
+            return "unknown error";
         }
-        return ss.str();
     }
 
-    int hex_to_value(char c)
+    // Statistics
+    namespace
+    {
+        std::atomic<const JsonStatsHooks *> installed_hooks(nullptr);
+    }
+
+    void set_stats_hooks(const JsonStatsHooks * hooks)
+    {
+        installed_hooks.store(hooks, std::memory_order_release);
+    }
+
+    const JsonStatsHooks * stats_hooks()
     {
-        if (std::isdigit(c))
-            return c - '0';
+        return installed_hooks.load(std::memory_order_acquire);
+    }
 
-        switch (c)
+#if EASY_JSON_STATS
+    namespace
+    {
+        // arena figures before a parse, the reader counts the rest
+        struct ParseStatsScope
         {
-        case 'a':
-        case 'A':
-            return 0xA;
-        case 'b':
-        case 'B':
-            return 0xB;
-        case 'c':
-        case 'C':
-            return 0xC;
-        case 'd':
-        case 'D':
-            return 0xD;
-        case 'e':
-        case 'E':
-            return 0xE;
-        case 'f':
-        case 'F':
-            return 0xF;
-        default:
-            return 0xFF;
+            const JsonArena * arena;
+            size_t allocations;
+            size_t allocated;
+            uint64_t start;
+            uint64_t map_ns;
+
+            explicit ParseStatsScope(const JsonArena * parse_arena, uint64_t map_time = 0)
+                : arena(parse_arena), allocations(parse_arena ? parse_arena->allocations() : 0),
+                  allocated(parse_arena ? parse_arena->bytes_allocated() : 0), start(stats_clock_ns()), map_ns(map_time)
+            {
+            }
+
+            template <typename Reader>
+            void report(const Reader & reader) const
+            {
+                const JsonStatsHooks * hooks = stats_hooks();
+                if (hooks == nullptr || hooks->on_parse == nullptr)
+                    return;
+                JsonParseStats stats = reader.statistics();
+                stats.parse_ns = stats_clock_ns() - start;
+                stats.map_ns = map_ns;
+                if (arena)
+                {
+                    stats.allocations = arena->allocations() - allocations;
+                    stats.bytes_allocated = arena->bytes_allocated() - allocated;
+                }
+                hooks->on_parse(stats, hooks->user);
+            }
+        };
+
+        void report_write(const JsonWriter & writer, uint64_t start)
+        {
+            const JsonStatsHooks * hooks = stats_hooks();
+            if (hooks == nullptr || hooks->on_write == nullptr)
+                return;
+            JsonWriteStats stats = writer.statistics();
+            stats.bytes = writer.bytes_written();
+            stats.write_ns = stats_clock_ns() - start;
+            hooks->on_write(stats, hooks->user);
         }
-    }
+    } // namespace
+#endif
 
-    // sample data class
-    class JsonNumber : public JsonAny
+    // out of line payloads, allocated from the document arena for document nodes
+    struct JsonObjectStorage
     {
-    public:
-        double value = 0;
+        struct Property
+        {
+            const char * key;
+            uint32_t key_length;
+            uint32_t hash;
+            JsonAny * value;
+
+            std::string_view key_view() const { return std::string_view(key, key_length); }
+        };
+
+        // objects above this size get a hash index, built on first lookup
+        static constexpr size_t INDEX_THRESHOLD = 16;
+
+        JsonDocument * document;
+        std::pmr::vector<Property> properties;    // keep order
+        std::pmr::vector<uint32_t> index;         // open addressing, property position + 1, 0 is empty
+        bool interned;                            // every key comes from the document key table
+
+        JsonObjectStorage(JsonDocument * doc, std::pmr::memory_resource * r)
+            : document(doc), properties(r), index(r), interned(doc != nullptr)
+        {
+        }
+
+        ~JsonObjectStorage()
+        {
+            // keys of heap objects are owned, document keys live in the arena
+            if (document == nullptr)
+            {
+                for (auto & property : properties)
+                    delete[] property.key;
+            }
+        }
+
+        const char * copy_key(std::string_view key)
+        {
+            char * buf = document ? static_cast<char *>(document->arena().allocate(key.size() + 1, 1))
+                                  : new char[key.size() + 1];
+            if (!key.empty())
+                memcpy(buf, key.data(), key.size());
+            buf[key.size()] = '\0';
+            return buf;
+        }
+
+        void insert_index(uint32_t position)
+        {
+            size_t mask = index.size() - 1;
+            size_t slot = properties[position].hash & mask;
+            while (index[slot] != 0)
+                slot = (slot + 1) & mask;
+            index[slot] = position + 1;
+        }
+
+        void rebuild_index()
+        {
+            size_t capacity = 32;
+            while (capacity < properties.size() * 2)
+                capacity <<= 1;
 
-        JsonNumber(const double & v) { value = v; }
+            index.assign(capacity, 0);
+            for (uint32_t i = 0; i < properties.size(); ++i)
+                insert_index(i);
+        }
 
-        std::string dump() override
+        Property * find(std::string_view key, uint32_t hash)
         {
-            char tmp[32] = { 0 };
-            snprintf(tmp, 32, "%f", to_number());
-            return tmp;
+            if (properties.size() <= INDEX_THRESHOLD)
+            {
+                for (auto & property : properties)
+                {
+                    if (property.hash == hash && property.key_view() == key)
+                        return &property;
+                }
+                return nullptr;
+            }
+
+            if (index.size() < properties.size() * 2)
+                rebuild_index();
+
+            size_t mask = index.size() - 1;
+            for (size_t slot = hash & mask; index[slot] != 0; slot = (slot + 1) & mask)
+            {
+                Property & property = properties[index[slot] - 1];
+                if (property.hash == hash && property.key_view() == key)
+                    return &property;
+            }
+            return nullptr;
+        }
+
+        // interned keys are unique within their document, so the key pointer
+        // identifies the property
+        Property * find(const JsonKey & key)
+        {
+            if (!interned || key.document() != document)
+                return key.valid() ? find(key.view(), key.hash()) : nullptr;
+
+            const char * data = key.view().data();
+            if (properties.size() <= INDEX_THRESHOLD)
+            {
+                for (auto & property : properties)
+                {
+                    if (property.key == data)
+                        return &property;
+                }
+                return nullptr;
+            }
+
+            if (index.size() < properties.size() * 2)
+                rebuild_index();
+
+            size_t mask = index.size() - 1;
+            for (size_t slot = key.hash() & mask; index[slot] != 0; slot = (slot + 1) & mask)
+            {
+                Property & property = properties[index[slot] - 1];
+                if (property.key == data)
+                    return &property;
+            }
+            return nullptr;
+        }
+
+        // only document objects may reference a key they do not own
+        void append(std::string_view key, uint32_t hash, JsonAny * value, bool copy)
+        {
+            const char * stored = (copy || document == nullptr) ? copy_key(key) : key.data();
+            interned = false;
+            push(Property{ stored, static_cast<uint32_t>(key.size()), hash, value });
+        }
+
+        void append(const JsonKey & key, JsonAny * value)
+        {
+            push(Property{ key.view().data(), static_cast<uint32_t>(key.view().size()), key.hash(), value });
+        }
+
+        void push(const Property & property)
+        {
+            properties.push_back(property);
+
+            // keep a built index in sync, it is grown lazily by find()
+            if (!index.empty() && index.size() >= properties.size() * 2)
+                insert_index(static_cast<uint32_t>(properties.size() - 1));
+        }
+
+        // builds the index find() would build, frozen objects are never written
+        void prepare_index()
+        {
+            if (properties.size() > INDEX_THRESHOLD && index.size() < properties.size() * 2)
+                rebuild_index();
         }
     };
 
-    class JsonBoolean : public JsonAny
+    // values of a packed array, allocated in one piece with the header
+    struct JsonPackedArray
     {
-    public:
-        bool value;
+        JsonAny * nodes;    // built for at()
+        size_t size;
+        JsonNumberType type;
 
-        JsonBoolean(const bool & v) { value = v; }
+        const uint64_t * values() const { return reinterpret_cast<const uint64_t *>(this + 1); }
+        uint64_t * values() { return reinterpret_cast<uint64_t *>(this + 1); }
+        JsonColumn column() const { return JsonColumn{ type, values(), size }; }
+    };
+
+    // columns of an array of objects sharing one key sequence, valid while
+    // the document epoch is unchanged
+    struct JsonArrayTable
+    {
+        struct Field
+        {
+            std::string_view key;
+            JsonColumn column;
+        };
 
-        std::string dump() override { return to_boolean() ? "true" : "false"; }
+        uint32_t epoch;
+        std::pmr::vector<Field> fields;
+
+        JsonArrayTable(uint32_t document_epoch, std::pmr::memory_resource * r) : epoch(document_epoch), fields(r) {}
     };
 
-    class JsonString : public JsonAny
+    struct JsonArrayStorage
     {
-    public:
-        std::string value;
+        JsonDocument * document;
+        std::pmr::vector<JsonAny *> properties;    // elements unless packed
+        JsonPackedArray * packed = nullptr;
+        JsonArrayTable * table = nullptr;          // made by the first column(key) of a table array
+
+        JsonArrayStorage(JsonDocument * doc, std::pmr::memory_resource * r)
+            : document(doc), properties(r)
+        {
+        }
+
+        size_t size() const { return packed ? packed->size : properties.size(); }
 
-        JsonString(const std::string & v) { value = v; }
+        JsonAny * nodes()
+        {
+            if (packed->nodes == nullptr)
+                packed->nodes = document->number_nodes(packed->type, packed->values(), packed->size);
+            return packed->nodes;
+        }
 
-        JsonString(const char * v) { value = (v ? v : ""); }
+        // back to one pointer per element, before a write
+        void unpack()
+        {
+            if (packed == nullptr)
+                return;
+            JsonAny * items = nodes();
+            properties.reserve(packed->size);
+            for (size_t i = 0; i < packed->size; ++i)
+                properties.push_back(items + i);
+            packed = nullptr;
+        }
 
-        JsonString(const char * v, size_t n)
+        // the table of a matching array, checked again after any container write
+        JsonArrayTable * current_table()
         {
-            value = v ? std::move(std::string(v, n)) : "";
+            if (table && table->epoch == document->_epoch)
+                return table;
+            table = nullptr;
+            if (!match_shape())
+                return nullptr;
+            JsonArena & arena = document->arena();
+            table = new (arena.allocate(sizeof(JsonArrayTable), alignof(JsonArrayTable))) JsonArrayTable(document->_epoch, &arena);
+            return table;
         }
 
-        std::string dump() override { return "\"" + escape(to_str()) + "\""; }
+        bool match_shape() const
+        {
+            if (document == nullptr || packed || properties.empty())
+                return false;
+            const JsonObject * first = properties[0] ? properties[0]->to_object() : nullptr;
+            if (first == nullptr)
+                return false;
+            for (auto * item : properties)
+            {
+                const JsonObject * row = item ? item->to_object() : nullptr;
+                if (row == nullptr || row->count() != first->count())
+                    return false;
+                for (int i = 0, n = static_cast<int>(first->count()); i < n; ++i)
+                {
+                    // interned keys are equal when their pointers are
+                    std::string_view key = row->key_view_at(i);
+                    std::string_view expected = first->key_view_at(i);
+                    if (key.data() != expected.data() && key != expected)
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        JsonColumn field(JsonArrayTable * current, std::string_view key)
+        {
+            for (const auto & entry : current->fields)
+            {
+                if (entry.key == key)
+                    return entry.column;
+            }
+
+            const JsonObject * first = properties[0]->to_object();
+            int position = 0;
+            while (position < static_cast<int>(first->count()) && first->key_view_at(position) != key)
+                ++position;
+            if (position == static_cast<int>(first->count()))
+                return JsonColumn();
+            JsonColumn column = gather(position);
+            current->fields.push_back(JsonArrayTable::Field{ first->key_view_at(position), column });
+            return column;
+        }
+
+        JsonColumn gather(int position) const
+        {
+            const JsonAny * sample = properties[0]->to_object()->value_at(position);
+            JsonNumberType type = sample->number_type();
+            if (!sample->is_number() || (type != JsonNumberType::Double && type != JsonNumberType::Int64))
+                return JsonColumn();
+            for (auto * row : properties)
+            {
+                const JsonAny * value = row->to_object()->value_at(position);
+                if (!value->is_number() || value->number_type() != type)
+                    return JsonColumn();
+            }
+
+            // int64 and double share a size, the column holds their bits
+            auto * values = static_cast<uint64_t *>(document->arena().allocate(properties.size() * sizeof(uint64_t), alignof(uint64_t)));
+            for (size_t i = 0; i < properties.size(); ++i)
+            {
+                const JsonAny * value = properties[i]->to_object()->value_at(position);
+                if (type == JsonNumberType::Int64)
+                {
+                    int64_t v = value->to_integer();
+                    memcpy(values + i, &v, sizeof(uint64_t));
+                }
+                else
+                {
+                    double v = value->to_number();
+                    memcpy(values + i, &v, sizeof(uint64_t));
+                }
+            }
+            return JsonColumn{ type, values, properties.size() };
+        }
+
+        // makes every lazily built form, frozen arrays are never written
+        void prepare()
+        {
+            if (packed)
+            {
+                nodes();
+                return;
+            }
+            JsonArrayTable * current = current_table();
+            if (current == nullptr)
+                return;
+            const JsonObject * first = properties[0]->to_object();
+            for (int i = 0, n = static_cast<int>(first->count()); i < n; ++i)
+                field(current, first->key_view_at(i));
+        }
     };
 
-    class JsonNull : public JsonAny
+    // document nodes are never destructed, their payload is released with the arena
+    JsonAny::~JsonAny()
     {
-    public:
-        JsonNull() = default;
+        if (in_document())
+            return;
 
-        std::string dump() override { return "null"; }
-    };
+        switch (_type)
+        {
+        case JsonType::String:
+            delete[] _v.s;
+            break;
+        case JsonType::Number:
+            if (_number_type == JsonNumberType::Raw)
+                delete[] _v.s;
+            break;
+        case JsonType::Object:
+            for (auto & p : _v.o->properties)
+                JsonAny::destroy(p.value);
+            delete _v.o;
+            break;
+        case JsonType::Array:
+            for (auto & item : _v.a->properties)
+                JsonAny::destroy(item);
+            delete _v.a;
+            break;
+        default:
+            break;
+        }
+    }
+
+    std::string JsonAny::dump() const
+    {
+        EASY_JSON_STAT(uint64_t start = stats_clock_ns());
+        std::string out;
+        JsonWriter writer(out);
+        writer.write(this);
+        writer.flush();
+        EASY_JSON_STAT(report_write(writer, start));
+        return out;
+    }
+
+    bool JsonAny::dump(JsonSink & sink) const
+    {
+        EASY_JSON_STAT(uint64_t start = stats_clock_ns());
+        JsonWriter writer(sink);
+        writer.write(this);
+        bool ok = writer.flush();
+        EASY_JSON_STAT(report_write(writer, start));
+        return ok;
+    }
 
-    // 
-    bool JsonAny::is_string() { return dynamic_cast<JsonString *>(this) != nullptr; }
-    bool JsonAny::is_boolean() { return dynamic_cast<JsonBoolean *>(this) != nullptr; }
-    bool JsonAny::is_object() { return dynamic_cast<JsonObject *>(this) != nullptr; }
-    bool JsonAny::is_number() { return dynamic_cast<JsonNumber *>(this) != nullptr; }
-    bool JsonAny::is_array() { return dynamic_cast<JsonArray *>(this) != nullptr; }
-    bool JsonAny::is_null() { return dynamic_cast<JsonNull *>(this) != nullptr; }
-
-    // 
-    std::string JsonAny::to_str() { return dynamic_cast<JsonString *>(this)->value; }
-    bool JsonAny::to_boolean() { return dynamic_cast<JsonBoolean *>(this)->value; }
-    int64_t JsonAny::to_integer() { return static_cast<int64_t>(to_number()); }
-    double JsonAny::to_number() { return dynamic_cast<JsonNumber *>(this)->value; }
-    JsonObject * JsonAny::to_object() { return dynamic_cast<JsonObject *>(this); }
-    JsonArray * JsonAny::to_array() { return dynamic_cast<JsonArray *>(this); }
+    bool JsonAny::equals(const JsonAny * other) const
+    {
+        if (other == this)
+            return true;
+        if (other == nullptr || other->_type != _type)
+            return false;
+
+        switch (_type)
+        {
+        case JsonType::Null:
+            return true;
+        case JsonType::Boolean:
+            return _v.b == other->_v.b;
+        case JsonType::String:
+            return str_view() == other->str_view();
+        case JsonType::Number:
+            if (_number_type == JsonNumberType::Raw && other->_number_type == JsonNumberType::Raw)
+                return number_text() == other->number_text();
+            if (is_integer() && other->is_integer())
+            {
+                // an int64 and a uint64 only match when both fit in int64
+                bool negative = _number_type == JsonNumberType::Int64 && _v.i < 0;
+                bool other_negative = other->_number_type == JsonNumberType::Int64 && other->_v.i < 0;
+                return negative == other_negative && _v.u == other->_v.u;
+            }
+            return to_number() == other->to_number();
+        case JsonType::Object:
+        {
+            const JsonObject * obj = to_object();
+            const JsonObject * other_obj = other->to_object();
+            size_t count = obj->count();
+            if (count != other_obj->count())
+                return false;
+            for (size_t i = 0; i < count; ++i)
+            {
+                const auto & property = _v.o->properties[i];
+                JsonAny * value = other_obj->get_property(property.key_view(), property.hash);
+                if (value == nullptr || !property.value->equals(value))
+                    return false;
+            }
+            return true;
+        }
+        case JsonType::Array:
+        {
+            const JsonArray * items = to_array();
+            const JsonArray * other_items = other->to_array();
+            if (items->count() != other_items->count())
+                return false;
+            for (int i = 0, n = static_cast<int>(items->count()); i < n; ++i)
+            {
+                const JsonAny * item = items->at(i);
+                const JsonAny * other_item = other_items->at(i);
+                if (item == nullptr ? other_item != nullptr : !item->equals(other_item))
+                    return false;
+            }
+            return true;
+        }
+        }
+        return false;
+    }
 
     //
-    JsonAny * JsonAny::str(const char * value) { return new JsonString(value); }
-    JsonAny * JsonAny::str(const char * value, int length) { return new JsonString(value, length); }
-    JsonAny * JsonAny::boolean(bool value) { return new JsonBoolean(value); }
-    JsonAny * JsonAny::integer(int64_t value) { return new JsonNumber(static_cast<double>(value)); }
-    JsonAny * JsonAny::number(double value) { return new JsonNumber(value); }
-    JsonAny * JsonAny::null() { return new JsonNull(); }
-    JsonObject * JsonAny::object() { return new JsonObject(); }
-    JsonArray * JsonAny::array() { return new JsonArray(); }
+    JsonAny * JsonAny::str(const char * value)
+    {
+        return str(value, value ? static_cast<int>(strlen(value)) : 0);
+    }
 
-    // Object
-    JsonObject::JsonObject()
+    JsonAny * JsonAny::str(const char * value, int length)
     {
+        auto * node = new JsonAny(JsonType::String);
+        size_t n = value ? static_cast<size_t>(length) : 0;
+        node->_v.s = new char[n + 1];
+        if (n)
+            memcpy(node->_v.s, value, n);
+        node->_v.s[n] = '\0';
+        node->_size = static_cast<uint32_t>(n);
+        return node;
     }
 
-    JsonObject::~JsonObject()
+    JsonAny * JsonAny::boolean(bool value)
     {
-        for (auto & p : properties)
-            delete p.second;
-        properties.clear();
+        auto * node = new JsonAny(JsonType::Boolean);
+        node->_v.b = value;
+        return node;
     }
 
-    size_t JsonObject::count() const
+    JsonAny * JsonAny::integer(int64_t value)
     {
-        return properties.size();
+        auto * node = new JsonAny(JsonType::Number);
+        node->_number_type = JsonNumberType::Int64;
+        node->_v.i = value;
+        return node;
     }
 
-    std::string JsonObject::key_at(int index) const
+    JsonAny * JsonAny::unsigned_integer(uint64_t value)
+    {
+        auto * node = new JsonAny(JsonType::Number);
+        node->_number_type = JsonNumberType::Uint64;
+        node->_v.u = value;
+        return node;
+    }
+
+    JsonAny * JsonAny::number(double value)
+    {
+        auto * node = new JsonAny(JsonType::Number);
+        node->_v.d = value;
+        return node;
+    }
+
+    JsonAny * JsonAny::raw_number(const char * text, int length)
+    {
+        auto * node = new JsonAny(JsonType::Number);
+        size_t n = text ? static_cast<size_t>(length) : 0;
+        node->_number_type = JsonNumberType::Raw;
+        node->_v.s = new char[n + 1];
+        if (n)
+            memcpy(node->_v.s, text, n);
+        node->_v.s[n] = '\0';
+        node->_size = static_cast<uint32_t>(n);
+        return node;
+    }
+
+    double JsonAny::raw_to_number() const
+    {
+        JsonNumberValue value;
+        if (parse_number(_v.s, _v.s + _size, value) == nullptr)
+            return 0.0;
+        switch (value.type)
+        {
+        case JsonNumberType::Int64:
+            return static_cast<double>(value.i);
+        case JsonNumberType::Uint64:
+            return static_cast<double>(value.u);
+        default:
+            return value.d;
+        }
+    }
+
+    int64_t JsonAny::raw_to_integer() const
     {
-        std::string ret;
-        try
+        JsonNumberValue value;
+        if (parse_number(_v.s, _v.s + _size, value) == nullptr)
+            return 0;
+        switch (value.type)
         {
-            ret = properties.at(index).first;
+        case JsonNumberType::Int64:
+            return value.i;
+        case JsonNumberType::Uint64:
+            return static_cast<int64_t>(value.u);
+        default:
+            return static_cast<int64_t>(value.d);
         }
-        catch (...)
+    }
+
+    JsonAny * JsonAny::null() { return new JsonAny(JsonType::Null); }
+
+    // heap containers are allocated as the JsonAny that destroy() deletes,
+    // JsonObject / JsonArray being views without a virtual destructor
+    JsonObject * JsonAny::object()
+    {
+        auto * node = new JsonAny(JsonType::Object);
+        node->_v.o = new JsonObjectStorage(nullptr, std::pmr::get_default_resource());
+        return static_cast<JsonObject *>(node);
+    }
+
+    JsonArray * JsonAny::array()
+    {
+        auto * node = new JsonAny(JsonType::Array);
+        node->_v.a = new JsonArrayStorage(nullptr, std::pmr::get_default_resource());
+        return static_cast<JsonArray *>(node);
+    }
+
+    void JsonAny::destroy(JsonAny * value)
+    {
+        if (value != nullptr && !value->in_document() && !(value->_flags & FLAG_ADOPTED))
+            delete value;
+    }
+
+    // Arena
+    JsonArena::JsonArena(std::pmr::memory_resource * upstream, size_t initial_block_size)
+    {
+        _upstream = upstream ? upstream : std::pmr::get_default_resource();
+        _initial_block_size = std::max<size_t>(initial_block_size, 256);
+        _next_block_size = _initial_block_size;
+    }
+
+    JsonArena::~JsonArena()
+    {
+        release();
+    }
+
+    void JsonArena::release()
+    {
+        while (_blocks != nullptr)
         {
-            return "";
+            Block * next = _blocks->next;
+            _upstream->deallocate(_blocks, _blocks->size, alignof(std::max_align_t));
+            _blocks = next;
         }
-        return ret;
+        _cur = _end = nullptr;
+        _next_block_size = _initial_block_size;
+        _used = 0;
+        _reserved = 0;
     }
 
-    JsonAny * JsonObject::value_at(int index) const
+    void JsonArena::reset()
     {
-        JsonAny * ret = nullptr;
-        try
+        if (_blocks == nullptr)
+            return;
+
+        // several blocks are merged into one holding all of them, so the next
+        // cycle of the same size is served from a single block
+        if (_blocks->next != nullptr)
         {
-            ret = properties.at(index).second;
+            size_t size = _reserved;
+            release();
+            add_block(size);
         }
-        catch (...)
+        _cur = reinterpret_cast<char *>(_blocks + 1);
+        _end = reinterpret_cast<char *>(_blocks) + _blocks->size;
+        _used = 0;
+    }
+
+    void JsonArena::add_block(size_t size)
+    {
+        auto * block = static_cast<Block *>(_upstream->allocate(size, alignof(std::max_align_t)));
+        block->next = _blocks;
+        block->size = size;
+        _blocks = block;
+        _reserved += size;
+        ++_allocations;
+        _allocated += size;
+        if (size == _next_block_size)
+            _next_block_size = std::min<size_t>(_next_block_size * 2, 1 << 20);
+
+        _cur = reinterpret_cast<char *>(block + 1);
+        _end = reinterpret_cast<char *>(block) + size;
+    }
+
+    void * JsonArena::do_allocate(size_t bytes, size_t alignment)
+    {
+        auto aligned = [alignment](char * ptr) {
+            return reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(ptr) + alignment - 1) & ~(alignment - 1));
+        };
+
+        char * ptr = aligned(_cur);
+        if (_cur == nullptr || ptr + bytes > _end)
         {
-            return nullptr;
+            // oversized requests get a block of their own
+            size_t need = sizeof(Block) + bytes + alignment;
+            add_block(std::max(_next_block_size, need));
+            ptr = aligned(_cur);
         }
-        return ret;
+
+        _cur = ptr + bytes;
+        _used += bytes;
+        return ptr;
+    }
+
+    std::pmr::memory_resource * JsonArena::thread_local_pool()
+    {
+        thread_local std::pmr::unsynchronized_pool_resource pool;
+        return &pool;
+    }
+
+    // Object
+    JsonObject::JsonObject(JsonDocument * document)
+        : JsonAny(JsonType::Object)
+    {
+        JsonArena & arena = document->arena();
+        _v.o = new (arena.allocate(sizeof(JsonObjectStorage), alignof(JsonObjectStorage)))
+            JsonObjectStorage(document, &arena);
+        _flags |= FLAG_IN_DOCUMENT;
+    }
+
+    size_t JsonObject::count() const
+    {
+        return _v.o->properties.size();
+    }
+
+    std::string JsonObject::key_at(int index) const
+    {
+        return std::string(key_view_at(index));
+    }
+
+    std::string_view JsonObject::key_view_at(int index) const
+    {
+        const auto & properties = _v.o->properties;
+        if (index < 0 || static_cast<size_t>(index) >= properties.size())
+            return std::string_view();
+        return properties[index].key_view();
+    }
+
+    JsonAny * JsonObject::value_at(int index) const
+    {
+        const auto & properties = _v.o->properties;
+        if (index < 0 || static_cast<size_t>(index) >= properties.size())
+            return nullptr;
+        return properties[index].value;
     }
 
     JsonObject * JsonObject::set_property(const char * key, JsonAny * value)
     {
-        if (nullptr == value || nullptr == key)
+        if (nullptr == key)
+            return this;
+        return set_property(std::string_view(key), value);
+    }
+
+    JsonObject * JsonObject::set_property(std::string_view key, JsonAny * value)
+    {
+        return put_property(key, value, true);
+    }
+
+    JsonObject * JsonObject::put_property(std::string_view key, JsonAny * value, bool copy_key)
+    {
+        JsonObjectStorage * storage = _v.o;
+        if (nullptr == value || (storage->document && !storage->document->adopt(value)))
             return this;
 
-        for (auto it = properties.begin(); it != properties.end(); ++it)
+        JsonObjectStorage::Property * property = nullptr;
+        if (storage->document)
+            ++storage->document->_epoch;
+        if (storage->document && storage->document->_intern_keys)
         {
-            if (it->first == key)
+            JsonKey interned = storage->document->intern(key, !copy_key);
+            property = storage->find(interned);
+            if (property == nullptr)
             {
-                delete it->second;
-                properties.insert(it, std::make_pair(key, value));
-                properties.erase(it);
+                storage->append(interned, value);
                 return this;
             }
         }
-        properties.push_back(std::make_pair(key, value));
+        else
+        {
+            uint32_t hash = hash_key(key);
+            property = storage->find(key, hash);
+            if (property == nullptr)
+            {
+                storage->append(key, hash, value, copy_key);
+                return this;
+            }
+        }
+
+        // a replaced document value stays with the document until it is reset
+        if (property->value != value && storage->document == nullptr)
+            JsonAny::destroy(property->value);
+        property->value = value;
         return this;
     }
 
@@ -226,499 +862,553 @@ namespace easy_json
     {
         if (nullptr == key)
             return nullptr;
-
-        for (const auto & property : properties)
-        {
-            if (property.first == key)
-                return property.second;
-        }
-        return nullptr;
+        return get_property(std::string_view(key));
     }
 
-    std::string JsonObject::dump()
+    JsonAny * JsonObject::get_property(std::string_view key) const
     {
-        if (properties.empty())
-            return "{}";
-
-        std::stringstream ss;
-        ss << '{';
-        for (const auto & property : properties)
-        {
-            ss << '\\' << property.first << ":\\" << property.second->dump() << ',';
-        }
+        return get_property(key, hash_key(key));
+    }
 
-        std::streampos size = ss.tellp();
-        size -= 1;
-        ss.seekp(size);
-        ss.put('}');
-        return ss.str();
+    JsonAny * JsonObject::get_property(std::string_view key, uint32_t hash) const
+    {
+        auto * property = _v.o->find(key, hash);
+        return property ? property->value : nullptr;
     }
 
+    JsonAny * JsonObject::get_property(const JsonKey & key) const
+    {
+        auto * property = _v.o->find(key);
+        return property ? property->value : nullptr;
+    }
 
-    // Array
-    JsonArray::JsonArray()
+    uint32_t JsonObject::hash_key(std::string_view key)
     {
+        // FNV-1a
+        uint32_t hash = 2166136261u;
+        for (unsigned char c : key)
+        {
+            hash ^= c;
+            hash *= 16777619u;
+        }
+        return hash;
     }
 
-    JsonArray::~JsonArray()
+    // Array
+    JsonArray::JsonArray(JsonDocument * document)
+        : JsonAny(JsonType::Array)
     {
-        for (auto & item : properties)
-            delete item;
-        properties.clear();
+        JsonArena & arena = document->arena();
+        _v.a = new (arena.allocate(sizeof(JsonArrayStorage), alignof(JsonArrayStorage)))
+            JsonArrayStorage(document, &arena);
+        _flags |= FLAG_IN_DOCUMENT;
     }
 
     size_t JsonArray::count() const
     {
-        return properties.size();
+        return _v.a->size();
     }
 
     JsonAny * JsonArray::at(int index) const
     {
-        JsonAny * ret = nullptr;
-        try
-        {
-            ret = properties.at(index);
-        }
-        catch (...)
-        {
+        JsonArrayStorage * storage = _v.a;
+        if (index < 0 || static_cast<size_t>(index) >= storage->size())
             return nullptr;
-        }
-        return ret;
+        if (storage->packed)
+            return storage->nodes() + index;
+        return storage->properties[index];
     }
 
     JsonArray * JsonArray::add(JsonAny * value)
     {
-        properties.push_back(value);
+        JsonArrayStorage * storage = _v.a;
+        if (storage->document && !storage->document->adopt(value))
+            return this;
+        if (storage->document)
+            ++storage->document->_epoch;
+        storage->unpack();
+        storage->properties.push_back(value);
         return this;
     }
 
-    std::string JsonArray::dump()
+    bool JsonArray::packed() const
+    {
+        return _v.a->packed != nullptr;
+    }
+
+    JsonColumn JsonArray::column() const
     {
-        std::stringstream ss;
-        ss << '[';
-        for (const auto & property : properties)
+        return _v.a->packed ? _v.a->packed->column() : JsonColumn();
+    }
+
+    JsonColumn JsonArray::column(std::string_view key) const
+    {
+        JsonArrayStorage * storage = _v.a;
+        if (storage->document && storage->document->_frozen)
         {
-            ss << property->dump() << ',';
+            // built by freeze(), read only from here on
+            if (storage->table == nullptr)
+                return JsonColumn();
+            for (const auto & entry : storage->table->fields)
+            {
+                if (entry.key == key)
+                    return entry.column;
+            }
+            return JsonColumn();
         }
+        JsonArrayTable * table = storage->current_table();
+        return table ? storage->field(table, key) : JsonColumn();
+    }
 
-        std::streampos size = ss.tellp();
-        size -= 1;
-        ss.seekp(size);
-        ss.put(']');
-        return ss.str();
+    // values holds the bits of count int64 / double numbers
+    void JsonArray::pack(JsonNumberType type, const uint64_t * values, size_t count)
+    {
+        JsonArrayStorage * storage = _v.a;
+        void * mem = storage->document->arena().allocate(sizeof(JsonPackedArray) + count * sizeof(uint64_t), alignof(JsonPackedArray));
+        auto * packed = new (mem) JsonPackedArray{ nullptr, count, type };
+        memcpy(packed->values(), values, count * sizeof(uint64_t));
+        storage->packed = packed;
     }
 
     // Parse
-    class JsonParser
+    JsonAny * JsonAny::parse(const char * str)
     {
-    private:
-        const char * str_start = nullptr;
-        const char * str_end = nullptr;
-        const char * p = nullptr;
-
-        uint32_t flag = 0;
-        JsonAny * root = nullptr;
-        int err = 0;
+        return str ? parse(str, strlen(str)) : nullptr;
+    }
 
-    protected:
-#define RETURN_ERROR(code) { err = code; return false; }
+    JsonAny * JsonAny::parse(std::string_view str)
+    {
+        return parse(str.data(), str.size());
+    }
 
-        char skip_space()
+    JsonAny * JsonAny::parse(const char * str, size_t length)
+    {
+        EASY_JSON_STAT(ParseStatsScope scope(nullptr));
+        JsonDomBuilder builder(nullptr, JSON_PARSE_DEFAULT);
+        JsonReader<JsonDomBuilder> reader(str, length);
+        bool ok = reader.parse(builder);
+        EASY_JSON_STAT(scope.report(reader));
+        if (!ok)
         {
-            while (p < str_end)
-            {
-                if (*p == ' ' || *p == '\r' || *p == '\n')
-                {
-                    ++p;
-                    continue;;
-                }
-                break;
-            }
-            return *p;
+            JsonAny * partial = builder.result();
+            AutoFree(JsonAny, partial);
+            return nullptr;
         }
+        return builder.result();
+    }
 
-        bool parse_unicode(std::string & value)
-        {
-            ++p;
-            uint8_t uc_b1, uc_b2, uc_b3, uc_b4;
-            if (str_end - p < 4 ||
-                (uc_b1 = hex_to_value(*p++)) == 0xFF ||
-                (uc_b2 = hex_to_value(*p++)) == 0xFF ||
-                (uc_b3 = hex_to_value(*p++)) == 0xFF ||
-                (uc_b4 = hex_to_value(*p++)) == 0xFF)
-                return false;
+    JsonAny * JsonAny::parse_file(const char * str)
+    {
+        JsonMappedFile file;
+        if (!file.open(str))
+            return nullptr;
+        return parse(file.data(), file.size());
+    }
 
-            uc_b1 = (uc_b1 << 4) | uc_b2;
-            uc_b2 = (uc_b3 << 4) | uc_b4;
-            uint32_t uchar = (uc_b1 << 8) | uc_b2;
+    // Document
+    JsonDocument::JsonDocument(std::pmr::memory_resource * upstream, size_t initial_block_size)
+        : _arena(upstream, initial_block_size), _adopted(std::pmr::get_default_resource())
+    {
+    }
 
-            if ((uchar & 0xF800) == 0xD800)
-            {
-                uint32_t uchar2;
+    JsonDocument::~JsonDocument()
+    {
+        clear();
+    }
 
-                if (str_end - p < 6 || (*++p) != '\\' || (*++p) != 'u' ||
-                    (uc_b1 = hex_to_value(*++p)) == 0xFF ||
-                    (uc_b2 = hex_to_value(*++p)) == 0xFF ||
-                    (uc_b3 = hex_to_value(*++p)) == 0xFF ||
-                    (uc_b4 = hex_to_value(*++p)) == 0xFF)
-                    return false;
+    template <typename T>
+    T * JsonDocument::create(JsonType type)
+    {
+        void * mem = _arena.allocate(sizeof(T), alignof(T));
+        T * node = new (mem) T();
+        node->_type = type;
+        node->_flags |= JsonAny::FLAG_IN_DOCUMENT;
+        return node;
+    }
 
-                uc_b1 = (uc_b1 << 4) | uc_b2;
-                uc_b2 = (uc_b3 << 4) | uc_b4;
-                uchar2 = (uc_b1 << 8) | uc_b2;
+    char * JsonDocument::copy_string(const char * value, size_t length)
+    {
+        auto * buf = static_cast<char *>(_arena.allocate(length + 1, 1));
+        if (length)
+            memcpy(buf, value, length);
+        buf[length] = '\0';
+        return buf;
+    }
 
-                uchar = 0x010000 | ((uchar & 0x3FF) << 10) | (uchar2 & 0x3FF);
-            }
+    JsonKey JsonDocument::intern_key(std::string_view key)
+    {
+        return intern(key, false);
+    }
 
-            if (uchar <= 0x7F)
-            {
-                value += uchar & 0XFF;
-            }
-            else if (uchar <= 0x7FF)
-            {
-                value += 0XC0 | (uchar >> 6);
-                value += 0X80 | (uchar & 0X3F);
-            }
-            else if (uchar <= 0x7FF)
-            {
-                value += 0XE0 | (uchar >> 12);
-                value += 0X80 | ((uchar >> 6) & 0x3F);
-                value += 0X80 | (uchar & 0X3F);
-            }
-            else if (uchar <= 0xFFFF)
-            {
-                value += 0XF0 | (uchar >> 18);
-                value += 0X80 | ((uchar >> 12) & 0x3F);
-                value += 0X80 | ((uchar >> 6) & 0x3F);
-                value += 0X80 | (uchar & 0X3F);
-            }
-            return true;
-        }
+    JsonKey JsonDocument::find_key(std::string_view key) const
+    {
+        if (_key_count == 0)
+            return JsonKey();
+        uint32_t hash = JsonObject::hash_key(key);
+        const KeySlot & slot = _keys[key_slot(key, hash)];
+        if (slot.generation != _key_generation)
+            return JsonKey();
+        return JsonKey(this, slot.key, slot.length, slot.hash);
+    }
 
-        bool parse_escape_character(std::string & value)
+    // stable keys point into input that outlives the document and are not copied
+    JsonKey JsonDocument::intern(std::string_view key, bool stable)
+    {
+        uint32_t hash = JsonObject::hash_key(key);
+        size_t slot = _keys.empty() ? 0 : key_slot(key, hash);
+        if (!_keys.empty() && _keys[slot].generation == _key_generation)
+            return JsonKey(this, _keys[slot].key, _keys[slot].length, hash);
+        if (_frozen)
+            return JsonKey();
+
+        if ((_key_count + 1) * 2 > _keys.size())
         {
-            ++p;
-            switch (*p)
-            {
-            case '\"':
-                value.push_back('\"');
-                ++p;
-                return true;
-            case '\\':
-                value.push_back('\\');
-                ++p;
-                return true;
-            case '/':
-                value.push_back('/');
-                ++p;
-                return true;
-            case 'b':
-                value.push_back('\b');
-                ++p;
-                return true;
-            case 'f':
-                value.push_back('\f');
-                ++p;
-                return true;
-            case 'n':
-                value.push_back('\n');
-                ++p;
-                return true;
-            case 'r':
-                value.push_back('\r');
-                ++p;
-                return true;
-            case 't':
-                value.push_back('\t');
-                ++p;
-                return true;
-            case 'u':
-                return parse_unicode(value);
-            default:
-                return false;
-            }
+            grow_keys();
+            slot = key_slot(key, hash);
         }
+        const char * stored = stable ? key.data() : copy_string(key.data(), key.size());
+        _keys[slot] = KeySlot{ stored, static_cast<uint32_t>(key.size()), hash, _key_generation };
+        ++_key_count;
+        return JsonKey(this, stored, static_cast<uint32_t>(key.size()), hash);
+    }
 
-        bool parse_string(std::string & value)
+    // slot holding key or the empty slot it would go to
+    size_t JsonDocument::key_slot(std::string_view key, uint32_t hash) const
+    {
+        size_t mask = _keys.size() - 1;
+        size_t slot = hash & mask;
+        for (; _keys[slot].generation == _key_generation; slot = (slot + 1) & mask)
         {
-            value.clear();
-            ++p;
-            while (*p != '\0')
-            {
-                if (*p == '\\')
-                {
-                    parse_escape_character(value);
-                    continue;
-                }
+            const KeySlot & entry = _keys[slot];
+            if (entry.hash == hash && std::string_view(entry.key, entry.length) == key)
+                break;
+        }
+        return slot;
+    }
 
-                if (*p == '\"')
-                    break;
+    void JsonDocument::grow_keys()
+    {
+        std::vector<KeySlot> old(std::max<size_t>(_keys.size() * 2, 64), KeySlot{ nullptr, 0, 0, 0 });
+        old.swap(_keys);
+        ++_parse_allocations;
 
-                value.push_back(*p++);
-            }
-            ++p;
-            return true;
+        size_t mask = _keys.size() - 1;
+        for (const auto & entry : old)
+        {
+            if (entry.generation != _key_generation)
+                continue;
+            size_t slot = entry.hash & mask;
+            while (_keys[slot].generation == _key_generation)
+                slot = (slot + 1) & mask;
+            _keys[slot] = entry;
         }
+    }
 
-        bool parse_string(JsonString *& value)
+    void JsonDocument::drop_keys()
+    {
+        _key_count = 0;
+        if (++_key_generation == 0)
         {
-            std::string tmp_string;
-            if (!parse_string(tmp_string))
-                return false;
-            value = static_cast<JsonString *>(JsonAny::str(tmp_string.c_str()));
-            return true;
+            // wrapped, stale slots could look live again
+            for (auto & entry : _keys)
+                entry.generation = 0;
+            _key_generation = 1;
         }
+    }
 
-        bool parse_array(JsonArray *& value)
+    JsonAny * JsonDocument::number_nodes(JsonNumberType type, const void * values, size_t count)
+    {
+        auto * nodes = static_cast<JsonAny *>(_arena.allocate(count * sizeof(JsonAny), alignof(JsonAny)));
+        for (size_t i = 0; i < count; ++i)
         {
-            JsonArray * array = JsonAny::array();
-            AutoFreeArray(JsonArray, array);
-            ++p;
+            JsonAny * node = new (nodes + i) JsonAny(JsonType::Number);
+            node->_flags |= JsonAny::FLAG_IN_DOCUMENT;
+            node->_number_type = type;
+            memcpy(&node->_v.u, static_cast<const uint64_t *>(values) + i, sizeof(uint64_t));
+        }
+        return nodes;
+    }
 
-            // empty array
-            if (skip_space() == ']')
+    void JsonDocument::freeze()
+    {
+        // walk every node but the subtrees shared from other frozen documents
+        std::vector<const JsonAny *> pending;
+        if (_root)
+            pending.push_back(_root);
+        while (!pending.empty())
+        {
+            const JsonAny * node = pending.back();
+            pending.pop_back();
+            if (const JsonObject * obj = node->to_object())
             {
-                value = array;
-                array = nullptr;
-                return true;
+                JsonObjectStorage * storage = obj->_v.o;
+                if (storage->document != nullptr && storage->document != this)
+                    continue;
+                storage->prepare_index();
+                for (auto & property : storage->properties)
+                    pending.push_back(property.value);
             }
-
-            JsonAny * array_value = nullptr;
-            while (true)
+            else if (const JsonArray * arr = node->to_array())
             {
-                array_value = nullptr;
-                if (!parse_value(array_value))
-                    return false;
-
-                array->add(array_value);
-                switch (skip_space())
-                {
-                case ',':
-                    ++p;
+                JsonArrayStorage * storage = arr->_v.a;
+                if (storage->document != nullptr && storage->document != this)
                     continue;
-                case']':
-                    break;
-                default:
-                    RETURN_ERROR(-1)
+                storage->prepare();
+                for (auto * item : storage->properties)
+                {
+                    if (item)
+                        pending.push_back(item);
                 }
-                if (*p == ']')
-                    break;
             }
-            ++p;
-            array_value = array;
-            array = nullptr;
-            return true;
         }
+        _frozen = true;
+    }
 
-        bool parse_object(JsonObject *& value)
-        {
-            JsonObject * obj = JsonAny::object();
-            AutoFree(JsonObject, obj);
-            ++p;
-
-            // empty object
-            if (skip_space() == '}')
-            {
-                value = obj;
-                obj = nullptr;
-                return true;
-            }
-
-            std::string key;
-            JsonAny * obj_value = nullptr;
+    JsonAny * JsonDocument::share(std::shared_ptr<const JsonDocument> source, const JsonAny * value)
+    {
+        if (!source || !source->frozen() || value == nullptr || _frozen)
+            return nullptr;
 
-            while (true)
+        // containers know the document that owns them, holding that one
+        // instead of source keeps reload chains from retaining every version
+        const JsonDocument * owner = nullptr;
+        if (value->is_object())
+            owner = value->_v.o->document;
+        else if (value->is_array())
+            owner = value->_v.a->document;
+        if (owner != nullptr && owner != source.get())
+        {
+            for (const auto & shared : source->_shared)
             {
-                if (skip_space() != '\"')
-                    return false;
-                if (!parse_string(key))
-                    return false;
-                if (skip_space() != ':')
-                    return false;
-
-                ++p;
-                obj_value = nullptr;
-                if (!parse_value(obj_value))
-                    return false;
-
-                obj->set_property(key.c_str(), obj_value);
-                switch (skip_space())
+                if (shared.get() == owner)
                 {
-                case ',':
-                    ++p;
-                    continue;
-                case '}':
+                    source = shared;
                     break;
-                default:
-                    return false;
                 }
-
-                if (*p == '}')
-                    break;
             }
-            ++p;
-            value = obj;
-            obj = nullptr;
-            return true;
         }
 
-        bool parse_boolean(JsonBoolean *& value, bool type)
-        {
-            int str_size = type ? 4 : 5;
-            if (0 != strncmp(p, type ? "true" : "false", str_size))
-                return false;
+        if (source.get() != this && std::find(_shared.begin(), _shared.end(), source) == _shared.end())
+            _shared.push_back(std::move(source));
+        // read-only through the frozen source, the cast only lets it be attached
+        return const_cast<JsonAny *>(value);
+    }
 
-            p += str_size;
-            value = static_cast<JsonBoolean *>(JsonAny::boolean(type));
-            return true;
+    // takes a heap node being attached to the tree, each one once. false
+    // when the document is frozen, the node is then deleted unless owned
+    bool JsonDocument::adopt(JsonAny * node)
+    {
+        bool owned = node == nullptr || node->in_document() || (node->_flags & JsonAny::FLAG_ADOPTED);
+        if (_frozen)
+        {
+            if (!owned)
+                delete node;
+            return false;
         }
-
-        bool parse_null(JsonNull *& value)
+        if (!owned)
         {
-            if (0 != strncmp(p, "null", 4))
-                return false;
-            p += 4;
-            value = static_cast<JsonNull *>(JsonAny::null());
-            return true;
+            node->_flags |= JsonAny::FLAG_ADOPTED;
+            _adopted.push_back(node);
         }
+        return true;
+    }
+
+    void JsonDocument::set_root(JsonAny * value)
+    {
+        if (adopt(value))
+            _root = value;
+    }
 
-        bool parse_number(JsonNumber *& value)
+    JsonDocument::ParseCache & JsonDocument::parse_cache()
+    {
+        if (!_parse_cache)
         {
-            const char * num_str_end = p;
-            char * end_ptr = nullptr;
-            double ret = 0;
-            try
-            {
+            _parse_cache = std::make_unique<ParseCache>();
+            ++_parse_allocations;
+        }
+        return *_parse_cache;
+    }
 
-                ret = strtod(num_str_end, &end_ptr);
-            }
-            catch (...)
-            {
-                return false;
-            }
-            p = end_ptr ? end_ptr : p;
+    void JsonDocument::reset()
+    {
+        drop_tree();
+        _arena.reset();
+    }
 
-            value = static_cast<JsonNumber *>(JsonAny::number(ret));
-            return true;
-        }
+    void JsonDocument::clear()
+    {
+        drop_tree();
+        _arena.release();
+        _parse_cache.reset();
+        std::vector<KeySlot>().swap(_keys);
+    }
 
-        bool parse_value(JsonAny *& json_value)
+    void JsonDocument::drop_tree()
+    {
+        // arena nodes are never destructed, their strings and containers
+        // live in the same arena and are reused or released with it
+        for (auto * node : _adopted)
+            delete node;
+        _adopted.clear();
+        _root = nullptr;
+        _frozen = false;
+        _shared.clear();
+        _source.reset();
+        drop_keys();
+    }
+
+    bool JsonDocument::parse(const char * str)
+    {
+        return str != nullptr && parse(str, strlen(str));
+    }
+
+    bool JsonDocument::parse(const char * str, size_t length, uint32_t flags)
+    {
+        reset();
+        auto & cache = parse_cache();
+        cache.builder.reset(this, flags);
+        cache.reader.reset(str, length, flags);
+        return run_parse(cache.reader, cache.builder);
+    }
+
+    bool JsonDocument::parse_in_situ(char * buffer, size_t length)
+    {
+        reset();
+        auto & cache = parse_cache();
+        cache.builder.reset(this, JSON_PARSE_BORROW_INPUT);
+        cache.reader.reset_in_situ(buffer, length);
+        return run_parse(cache.reader, cache.builder);
+    }
+
+    template <typename Reader>
+    bool JsonDocument::run_parse(Reader & reader, JsonDomBuilder & builder, uint64_t map_ns)
+    {
+        EASY_JSON_STAT(ParseStatsScope scope(&_arena, map_ns));
+        (void)map_ns;
+        size_t capacity = reader.buffer_capacity() + builder.buffer_capacity();
+        reader.set_limits(_limits);
+        bool ok = reader.parse(builder);
+        if (reader.buffer_capacity() + builder.buffer_capacity() > capacity)
+            ++_parse_allocations;
+        EASY_JSON_STAT(scope.report(reader));
+        _error = reader.error();
+        _error_offset = reader.offset();
+        return finish_parse(ok, builder);
+    }
+
+    bool JsonDocument::finish_parse(bool ok, JsonDomBuilder & builder)
+    {
+        if (!ok)
         {
-            char c = skip_space();
-            switch (c)
-            {
-            case '\"':
-            {
-                JsonString * str_value = nullptr;
-                if (!parse_string(str_value))
-                    return false;
-                json_value = str_value;
-                break;
-            }
-            case '[':
-            {
-                JsonArray * array_value = nullptr;
-                if (!parse_array(array_value))
-                    return false;
-                json_value = array_value;
-                break;
-            }
-            case '{':
-            {
-                JsonObject * object_value = nullptr;
-                if (!parse_object(object_value))
-                    return false;
-                json_value = object_value;
-            }
-            break;
-            case 't':
-            {
-                JsonBoolean * true_value = nullptr;
-                if (!parse_boolean(true_value, true))
-                    return false;
-                json_value = true_value;
-            }
-            break;
-            case 'f':
-            {
-                JsonBoolean * false_value = nullptr;
-                if (!parse_boolean(false_value, false))
-                    return false;
-                json_value = false_value;
-                break;
-            }
-            case 'n':
-            {
-                JsonNull * null_value = nullptr;
-                if (!parse_null(null_value))
-                    return false;
-                json_value = null_value;
-                break;
-            }
-            default:
-            {
-                JsonNumber * number_value = nullptr;
-                if (!parse_number(number_value))
-                    return false;
-                json_value = number_value;
-            }
-            }
-            return true;
+            reset();
+            return false;
         }
+        _root = builder.result();
+        return true;
+    }
 
-    public:
-        JsonParser(const char * json_string, size_t str_len)
+    bool JsonDocument::parse_file(const char * path, uint32_t flags)
+    {
+        uint64_t map_ns = 0;
+        EASY_JSON_STAT(map_ns = stats_clock_ns());
+        auto file = std::make_unique<JsonMappedFile>();
+        if (!file->open(path))
         {
-            str_start = json_string;
-            str_end = str_start + str_len;
+            reset();
+            _error = JSON_ERROR_FILE;
+            _error_offset = 0;
+            return false;
         }
+        EASY_JSON_STAT(map_ns = stats_clock_ns() - map_ns);
 
-        bool parse()
-        {
-            p = str_start;
-            if (str_end - str_start >= 3 &&
-                str_start[0] == 0XEF &&
-                str_start[1] == 0XBB &&
-                str_start[2] == 0XBF) // UTF-8 BOM
-                p += 3;
+        reset();
+        auto & cache = parse_cache();
+        cache.builder.reset(this, flags);
+        cache.reader.reset(file->data(), file->size(), flags);
+        if (!run_parse(cache.reader, cache.builder, map_ns))
+            return false;
+        if (flags & JSON_PARSE_BORROW_INPUT)
+            _source = std::move(file);
+        return true;
+    }
 
-            if (*p == '{')
-            {
-                JsonObject * obj = nullptr;
-                if (!parse_object(obj))
-                    return false;
+    JsonAny * JsonDocument::str(const char * value)
+    {
+        return str(value, value ? static_cast<int>(strlen(value)) : 0);
+    }
 
-                root = obj;
-                return true;
-            }
+    JsonAny * JsonDocument::str(const char * value, int length)
+    {
+        auto * node = create<JsonAny>(JsonType::String);
+        size_t n = value ? static_cast<size_t>(length) : 0;
+        node->_v.s = copy_string(value, n);
+        node->_size = static_cast<uint32_t>(n);
+        return node;
+    }
 
-            if (*p == '[')
-            {
-                JsonArray * json_array = nullptr;
-                if (!parse_array(json_array))
-                    return false;
+    JsonAny * JsonDocument::str_ref(std::string_view value)
+    {
+        auto * node = create<JsonAny>(JsonType::String);
+        node->_v.s = const_cast<char *>(value.data());
+        node->_size = static_cast<uint32_t>(value.size());
+        return node;
+    }
 
-                root = json_array;
-                return true;
-            }
+    JsonAny * JsonDocument::boolean(bool value)
+    {
+        auto * node = create<JsonAny>(JsonType::Boolean);
+        node->_v.b = value;
+        return node;
+    }
 
-            return false;
-        }
+    JsonAny * JsonDocument::integer(int64_t value)
+    {
+        auto * node = create<JsonAny>(JsonType::Number);
+        node->_number_type = JsonNumberType::Int64;
+        node->_v.i = value;
+        return node;
+    }
 
-        JsonAny * result() const { return root; }
-        int error() const { return err; }
-    };
+    JsonAny * JsonDocument::unsigned_integer(uint64_t value)
+    {
+        auto * node = create<JsonAny>(JsonType::Number);
+        node->_number_type = JsonNumberType::Uint64;
+        node->_v.u = value;
+        return node;
+    }
 
-    JsonAny * JsonAny::parse(const char * str)
+    JsonAny * JsonDocument::number(double value)
     {
-        JsonParser parser(str, strlen(str));
-        return parser.parse() ? parser.result() : nullptr;
+        auto * node = create<JsonAny>(JsonType::Number);
+        node->_v.d = value;
+        return node;
     }
 
-    JsonAny * JsonAny::parse_file(const char * str)
+    JsonAny * JsonDocument::raw_number(const char * text, int length)
+    {
+        size_t n = text ? static_cast<size_t>(length) : 0;
+        return raw_number_ref(std::string_view(copy_string(text, n), n));
+    }
+
+    JsonAny * JsonDocument::raw_number_ref(std::string_view text)
+    {
+        auto * node = create<JsonAny>(JsonType::Number);
+        node->_number_type = JsonNumberType::Raw;
+        node->_v.s = const_cast<char *>(text.data());
+        node->_size = static_cast<uint32_t>(text.size());
+        return node;
+    }
+
+    JsonAny * JsonDocument::null() { return create<JsonAny>(JsonType::Null); }
+    JsonObject * JsonDocument::object()
+    {
+        void * mem = _arena.allocate(sizeof(JsonObject), alignof(JsonObject));
+        return new (mem) JsonObject(this);
+    }
+
+    JsonArray * JsonDocument::array()
     {
-        std::ifstream ifs(str);
-        std::string buf((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
-        return parse(buf.c_str());
+        void * mem = _arena.allocate(sizeof(JsonArray), alignof(JsonArray));
+        return new (mem) JsonArray(this);
     }
 } // namespace easy_json
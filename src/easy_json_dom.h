@@ -0,0 +1,207 @@
+﻿#pragma once
+#include "easy_json_reader.h"
+
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace easy_json
+{
+    // Handler building the tree, from a document arena or the heap
+    class JsonDomBuilder : public JsonBaseHandler
+    {
+    private:
+        JsonDocument * document = nullptr;
+        uint32_t flag = 0;
+        JsonAny * root = nullptr;
+        std::vector<JsonAny *> stack;    // open containers
+
+        std::string_view key;
+        bool key_stable = false;
+
+        // Numbers of the innermost array while it holds nothing else, they
+        // become one packed column when it closes. Only the innermost array
+        // can be packing: any other value opened inside it ends that.
+        bool packing = false;
+        JsonNumberType packing_type = JsonNumberType::Double;
+        std::vector<uint64_t> numbers;
+
+        // nodes come from the document arena when parsing into a JsonDocument
+        JsonAny * make_string(std::string_view value, bool borrow)
+        {
+            if (document)
+                return borrow ? document->str_ref(value) : document->str(value.data(), static_cast<int>(value.size()));
+            return JsonAny::str(value.data(), static_cast<int>(value.size()));
+        }
+
+        JsonAny * make_number(const JsonNumberValue & v)
+        {
+            switch (v.type)
+            {
+            case JsonNumberType::Int64:
+                return document ? document->integer(v.i) : JsonAny::integer(v.i);
+            case JsonNumberType::Uint64:
+                return document ? document->unsigned_integer(v.u) : JsonAny::unsigned_integer(v.u);
+            default:
+                return document ? document->number(v.d) : JsonAny::number(v.d);
+            }
+        }
+
+        JsonAny * make_raw_number(std::string_view text)
+        {
+            if (!document)
+                return JsonAny::raw_number(text.data(), static_cast<int>(text.size()));
+            if (flag & JSON_PARSE_BORROW_INPUT)
+                return document->raw_number_ref(text);
+            return document->raw_number(text.data(), static_cast<int>(text.size()));
+        }
+
+        bool pack_number(const JsonNumberValue & v)
+        {
+            if (v.type != JsonNumberType::Int64 && v.type != JsonNumberType::Double)
+                return false;
+            if (numbers.empty())
+                packing_type = v.type;
+            else if (v.type != packing_type)
+                return false;
+
+            uint64_t bits;
+            if (v.type == JsonNumberType::Int64)
+                memcpy(&bits, &v.i, sizeof(bits));
+            else
+                memcpy(&bits, &v.d, sizeof(bits));
+            numbers.push_back(bits);
+            return true;
+        }
+
+        // the array is not homogeneous, its numbers become nodes after all
+        void stop_packing()
+        {
+            packing = false;
+            auto * arr = static_cast<JsonArray *>(stack.back());
+            for (uint64_t bits : numbers)
+            {
+                if (packing_type == JsonNumberType::Int64)
+                {
+                    int64_t i;
+                    memcpy(&i, &bits, sizeof(i));
+                    arr->add(document->integer(i));
+                }
+                else
+                {
+                    double d;
+                    memcpy(&d, &bits, sizeof(d));
+                    arr->add(document->number(d));
+                }
+            }
+            numbers.clear();
+        }
+
+        // values are attached as soon as they are created, so a failed parse
+        // only has to free the root
+        bool add(JsonAny * value)
+        {
+            if (packing)
+                stop_packing();
+            if (stack.empty())
+            {
+                root = value;
+                return true;
+            }
+
+            JsonAny * parent = stack.back();
+            if (parent->is_array())
+                static_cast<JsonArray *>(parent)->add(value);
+            else
+                static_cast<JsonObject *>(parent)->put_property(key, value, !(document && key_stable));
+            return true;
+        }
+
+    public:
+        JsonDomBuilder(JsonDocument * doc, uint32_t flags)
+        {
+            document = doc;
+            flag = flags;
+        }
+
+        // starts a new tree, the container stack keeps its capacity
+        void reset(JsonDocument * doc, uint32_t flags)
+        {
+            document = doc;
+            flag = flags;
+            root = nullptr;
+            stack.clear();
+            key = std::string_view();
+            key_stable = false;
+            packing = false;
+            numbers.clear();
+        }
+
+        size_t buffer_capacity() const { return stack.capacity() * sizeof(JsonAny *) + numbers.capacity() * sizeof(uint64_t); }
+
+        JsonAny * result() const { return root; }
+
+        bool on_null() { return add(document ? document->null() : JsonAny::null()); }
+        bool on_boolean(bool v) { return add(document ? document->boolean(v) : JsonAny::boolean(v)); }
+
+        bool on_number(const JsonNumberValue & v, std::string_view text)
+        {
+            if (packing && pack_number(v))
+                return true;
+            return add((flag & JSON_PARSE_RAW_NUMBERS) ? make_raw_number(text) : make_number(v));
+        }
+
+        bool on_string(std::string_view value, bool stable)
+        {
+            return add(make_string(value, document && stable));
+        }
+
+        bool on_key(std::string_view name, bool stable)
+        {
+            key = name;
+            key_stable = stable;
+            return true;
+        }
+
+        bool on_start_object()
+        {
+            JsonObject * obj = document ? document->object() : JsonAny::object();
+            add(obj);
+            stack.push_back(obj);
+            return true;
+        }
+
+        bool on_end_object(size_t)
+        {
+            stack.pop_back();
+            return true;
+        }
+
+        bool on_start_array()
+        {
+            JsonArray * arr = document ? document->array() : JsonAny::array();
+            add(arr);
+            stack.push_back(arr);
+            // raw numbers keep their text and stay nodes
+            packing = document != nullptr && !(flag & JSON_PARSE_RAW_NUMBERS);
+            return true;
+        }
+
+        bool on_end_array(size_t)
+        {
+            if (packing && !numbers.empty())
+                static_cast<JsonArray *>(stack.back())->pack(packing_type, numbers.data(), numbers.size());
+            packing = false;
+            numbers.clear();
+            stack.pop_back();
+            return true;
+        }
+    };
+
+    // reader and builder kept by a document between parses
+    struct JsonDocument::ParseCache
+    {
+        JsonDomBuilder builder{ nullptr, JSON_PARSE_DEFAULT };
+        JsonReader<JsonDomBuilder> reader{ "", 0 };
+    };
+} // namespace easy_json
@@ -0,0 +1,176 @@
+﻿#include "easy_json_file.h"
+
+#include <cstdio>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace easy_json
+{
+    JsonMappedFile::~JsonMappedFile()
+    {
+        close();
+    }
+
+    void JsonMappedFile::close()
+    {
+#if !defined(_WIN32)
+        if (_mapped && _size > 0)
+            munmap(const_cast<char *>(_data), _size);
+#endif
+        _data = nullptr;
+        _size = 0;
+        _mapped = false;
+        std::vector<char>().swap(_buffer);
+    }
+
+#if !defined(_WIN32)
+    bool JsonMappedFile::open(const char * path)
+    {
+        close();
+        if (path == nullptr)
+            return false;
+
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+        bool ok = fstat(fd, &st) == 0;
+        // empty regular files may still have content (/proc), read those
+        if (ok && S_ISREG(st.st_mode) && st.st_size > 0)
+        {
+            _size = static_cast<size_t>(st.st_size);
+            void * addr = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED)
+            {
+#ifdef MADV_SEQUENTIAL
+                madvise(addr, _size, MADV_SEQUENTIAL);
+#endif
+                _data = static_cast<const char *>(addr);
+                _mapped = true;
+                ::close(fd);
+                return true;
+            }
+            _size = 0;
+        }
+
+        // not mappable: one read for a known size, doubling reads for streams
+        if (ok)
+        {
+            bool sized = S_ISREG(st.st_mode) && st.st_size > 0;
+            size_t used = 0;
+            _buffer.resize(sized ? static_cast<size_t>(st.st_size) : 64 * 1024);
+            while (true)
+            {
+                if (used == _buffer.size())
+                {
+                    // a full buffer of known size only needs EOF confirmed,
+                    // it grows if the file did since fstat
+                    char extra;
+                    ssize_t n = sized ? ::read(fd, &extra, 1) : 0;
+                    if (n < 0)
+                    {
+                        ok = false;
+                        break;
+                    }
+                    if (sized && n == 0)
+                        break;
+                    _buffer.resize(_buffer.size() * 2);
+                    if (sized)
+                    {
+                        _buffer[used++] = extra;
+                        sized = false;
+                    }
+                }
+                ssize_t n = ::read(fd, _buffer.data() + used, _buffer.size() - used);
+                if (n < 0)
+                {
+                    ok = false;
+                    break;
+                }
+                if (n == 0)
+                    break;
+                used += static_cast<size_t>(n);
+            }
+            _buffer.resize(used);
+        }
+        ::close(fd);
+
+        if (!ok)
+        {
+            close();
+            return false;
+        }
+        _data = _buffer.data();
+        _size = _buffer.size();
+        return true;
+    }
+#else
+    bool JsonMappedFile::open(const char * path)
+    {
+        close();
+        FILE * file = path ? fopen(path, "rb") : nullptr;
+        if (file == nullptr)
+            return false;
+
+        bool ok = true;
+        bool sized = false;
+        size_t used = 0;
+        if (fseek(file, 0, SEEK_END) == 0)
+        {
+            long size = ftell(file);
+            if (size > 0)
+            {
+                _buffer.resize(static_cast<size_t>(size));
+                sized = true;
+            }
+            fseek(file, 0, SEEK_SET);
+        }
+        if (_buffer.empty())
+            _buffer.resize(64 * 1024);
+
+        while (true)
+        {
+            if (used == _buffer.size())
+            {
+                // as above, a known size only needs EOF confirmed
+                int extra = sized ? fgetc(file) : 0;
+                if (sized && extra == EOF)
+                {
+                    ok = ferror(file) == 0;
+                    break;
+                }
+                _buffer.resize(_buffer.size() * 2);
+                if (sized)
+                {
+                    _buffer[used++] = static_cast<char>(extra);
+                    sized = false;
+                }
+            }
+            size_t n = fread(_buffer.data() + used, 1, _buffer.size() - used, file);
+            used += n;
+            if (n == 0)
+            {
+                ok = ferror(file) == 0;
+                break;
+            }
+        }
+        fclose(file);
+
+        if (!ok)
+        {
+            close();
+            return false;
+        }
+        _buffer.resize(used);
+        _data = _buffer.data();
+        _size = _buffer.size();
+        return true;
+    }
+#endif
+} // namespace easy_json
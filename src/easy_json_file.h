@@ -0,0 +1,32 @@
+﻿#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace easy_json
+{
+    // Read-only view of a whole file. Regular files are memory mapped with a
+    // sequential access hint, anything else (pipes, /proc, platforms without
+    // mmap) is read into a buffer sized from the file when possible.
+    class JsonMappedFile
+    {
+    public:
+        JsonMappedFile() = default;
+        ~JsonMappedFile();
+
+        JsonMappedFile(const JsonMappedFile &) = delete;
+        JsonMappedFile & operator=(const JsonMappedFile &) = delete;
+
+        bool open(const char * path);
+        void close();
+
+        const char * data() const { return _data; }
+        size_t size() const { return _size; }
+        bool mapped() const { return _mapped; }
+
+    private:
+        const char * _data = nullptr;
+        size_t _size = 0;
+        bool _mapped = false;
+        std::vector<char> _buffer;
+    };
+} // namespace easy_json
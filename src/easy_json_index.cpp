@@ -0,0 +1,383 @@
+﻿#include "easy_json_reader.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EASY_JSON_INDEX_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define EASY_JSON_INDEX_AVX2 1
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define EASY_JSON_INDEX_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace easy_json
+{
+    namespace
+    {
+        // bit i of every mask describes byte i of a 64 byte block
+        struct BlockMasks
+        {
+            uint64_t quote;
+            uint64_t backslash;
+            uint64_t op;            // { } [ ] : ,
+            uint64_t whitespace;
+        };
+
+        typedef JsonStructuralIndexer::State IndexState;
+
+        inline int trailing_zeros(uint64_t mask)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_ctzll(mask);
+#else
+            unsigned long index;
+            _BitScanForward64(&index, mask);
+            return static_cast<int>(index);
+#endif
+        }
+
+        inline int popcount(uint64_t mask)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_popcountll(mask);
+#else
+            return static_cast<int>(__popcnt64(mask));
+#endif
+        }
+
+        // bit i set when an odd number of quote bits are at or below i
+        inline uint64_t prefix_xor(uint64_t x)
+        {
+            x ^= x << 1;
+            x ^= x << 2;
+            x ^= x << 4;
+            x ^= x << 8;
+            x ^= x << 16;
+            x ^= x << 32;
+            return x;
+        }
+
+        // quote mask with escaped quotes removed. Escapes are resolved one
+        // backslash at a time, they are rare enough that a branchy loop beats
+        // the carry tricks.
+        inline uint64_t unescaped_quotes(const BlockMasks & m, IndexState & state)
+        {
+            uint64_t escaped = state.escape_carry;
+            uint64_t backslash = m.backslash & ~state.escape_carry;
+            state.escape_carry = 0;
+            while (backslash != 0)
+            {
+                int i = trailing_zeros(backslash);
+                if (i == 63)
+                {
+                    state.escape_carry = 1;
+                    break;
+                }
+                escaped |= uint64_t(1) << (i + 1);
+                backslash &= ~(uint64_t(3) << i);
+            }
+            return m.quote & ~escaped;
+        }
+
+        // Turns the masks of a block into structural positions: operators and
+        // the first byte of every string / number / literal, with string
+        // contents masked out. quote_prefix is prefix_xor(quote).
+        inline uint32_t * index_block(const BlockMasks & m, uint64_t quote, uint64_t quote_prefix,
+                                      IndexState & state, uint32_t base, uint32_t * out)
+        {
+            uint64_t in_string = quote_prefix ^ state.in_string;
+            state.in_string = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+            // string bodies and closing quotes, the opening quote stays visible
+            uint64_t string_tail = in_string ^ quote;
+
+            uint64_t scalar = ~(m.op | m.whitespace);
+            uint64_t bare = scalar & ~quote;
+            uint64_t follows_bare = (bare << 1) | state.scalar_carry;
+            state.scalar_carry = bare >> 63;
+
+            uint64_t structural = (m.op | (scalar & ~follows_bare)) & ~string_tail;
+            if (structural == 0)
+                return out;
+
+            // write positions eight at a time past the count, fewer mispredicts
+            // than a branch per bit. Never more than 64 entries are touched.
+            int count = popcount(structural);
+            uint32_t * next = out;
+            while (true)
+            {
+                for (int i = 0; i < 8; ++i)
+                {
+                    next[i] = base + static_cast<uint32_t>(trailing_zeros(structural | (uint64_t(1) << 63)));
+                    structural &= structural - 1;
+                }
+                next += 8;
+                if (structural == 0)
+                    break;
+            }
+            return out + count;
+        }
+
+        // pads the last partial block with blanks, they are never structural
+        inline const char * tail_block(const char * data, size_t size, size_t offset, char * tail)
+        {
+            memset(tail, ' ', 64);
+            memcpy(tail, data + offset, size - offset);
+            return tail;
+        }
+
+        inline bool is_op(unsigned char c)
+        {
+            return c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',';
+        }
+
+        inline bool is_blank(unsigned char c)
+        {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        }
+
+        BlockMasks classify_scalar(const char * block)
+        {
+            BlockMasks m = {};
+            for (int i = 0; i < 64; ++i)
+            {
+                unsigned char c = static_cast<unsigned char>(block[i]);
+                uint64_t bit = uint64_t(1) << i;
+                if (c == '"')
+                    m.quote |= bit;
+                else if (c == '\\')
+                    m.backslash |= bit;
+                else if (is_op(c))
+                    m.op |= bit;
+                else if (is_blank(c))
+                    m.whitespace |= bit;
+            }
+            return m;
+        }
+
+#ifdef EASY_JSON_INDEX_SSE2
+        BlockMasks classify_sse2(const char * block)
+        {
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i slash = _mm_set1_epi8('\\');
+            const __m128i lower = _mm_set1_epi8(0x20);
+            const __m128i open = _mm_set1_epi8('{');     // '[' | 0x20
+            const __m128i close = _mm_set1_epi8('}');    // ']' | 0x20
+            const __m128i colon = _mm_set1_epi8(':');
+            const __m128i comma = _mm_set1_epi8(',');
+            const __m128i space = _mm_set1_epi8(' ');
+            const __m128i tab = _mm_set1_epi8('\t');
+            const __m128i lf = _mm_set1_epi8('\n');
+            const __m128i cr = _mm_set1_epi8('\r');
+
+            BlockMasks m = {};
+            for (int i = 0; i < 4; ++i)
+            {
+                __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i * 16));
+                __m128i folded = _mm_or_si128(c, lower);
+                __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)),
+                                          _mm_or_si128(_mm_cmpeq_epi8(c, colon), _mm_cmpeq_epi8(c, comma)));
+                __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, space), _mm_cmpeq_epi8(c, tab)),
+                                          _mm_or_si128(_mm_cmpeq_epi8(c, lf), _mm_cmpeq_epi8(c, cr)));
+                int shift = i * 16;
+                m.quote |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(c, quote)))) << shift;
+                m.backslash |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(c, slash)))) << shift;
+                m.op |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(op))) << shift;
+                m.whitespace |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(ws))) << shift;
+            }
+            return m;
+        }
+#endif
+
+#ifdef EASY_JSON_INDEX_AVX2
+        // byte classes through nibble table lookups: a byte is blank when it
+        // equals the table entry of its low nibble, same for operators with
+        // '[' and ']' folded onto '{' and '}' by setting bit 5
+        __attribute__((target("avx2")))
+        inline BlockMasks classify_avx2(const char * block)
+        {
+            const __m256i blank_table = _mm256_setr_epi8(' ', 0, 0, 0, 0, 0, 0, 0, 0, '\t', '\n', 0, 0, '\r', 0, 0,
+                                                         ' ', 0, 0, 0, 0, 0, 0, 0, 0, '\t', '\n', 0, 0, '\r', 0, 0);
+            const __m256i op_table = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0,
+                                                      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0);
+            const __m256i quote = _mm256_set1_epi8('"');
+            const __m256i slash = _mm256_set1_epi8('\\');
+            const __m256i lower = _mm256_set1_epi8(0x20);
+            const __m256i control = _mm256_set1_epi8(0x1F);
+
+            BlockMasks m = {};
+            for (int i = 0; i < 2; ++i)
+            {
+                __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + i * 32));
+                __m256i ws = _mm256_cmpeq_epi8(c, _mm256_shuffle_epi8(blank_table, c));
+                // control bytes 0x0C and 0x1A fold onto ',' and ':', mask them out
+                __m256i op = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_or_si256(c, lower), _mm256_shuffle_epi8(op_table, c)),
+                                              _mm256_cmpgt_epi8(c, control));
+                int shift = i * 32;
+                m.quote |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, quote)))) << shift;
+                m.backslash |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, slash)))) << shift;
+                m.op |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(op))) << shift;
+                m.whitespace |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(ws))) << shift;
+            }
+            return m;
+        }
+
+        // carry-less multiply by all ones is a prefix xor in one instruction
+        __attribute__((target("pclmul")))
+        inline uint64_t prefix_xor_clmul(uint64_t x)
+        {
+            __m128i product = _mm_clmulepi64_si128(_mm_set_epi64x(0, static_cast<int64_t>(x)), _mm_set1_epi8(-1), 0);
+            return static_cast<uint64_t>(_mm_cvtsi128_si64(product));
+        }
+
+        __attribute__((target("avx2,pclmul,popcnt,bmi")))
+        size_t index_avx2(const char * data, size_t size, size_t & offset, IndexState & state, uint32_t * out, size_t capacity)
+        {
+            uint32_t * begin = out;
+            uint32_t * limit = out + capacity - 64;
+            char tail[64];
+            for (; offset < size && out <= limit; offset += 64)
+            {
+                const char * block = size - offset >= 64 ? data + offset : tail_block(data, size, offset, tail);
+                BlockMasks m = classify_avx2(block);
+                uint64_t quote = unescaped_quotes(m, state);
+                out = index_block(m, quote, prefix_xor_clmul(quote), state, static_cast<uint32_t>(offset), out);
+            }
+            return static_cast<size_t>(out - begin);
+        }
+#endif
+
+#ifdef EASY_JSON_INDEX_NEON
+        // NEON has no movemask, weight the lanes and add them pairwise instead
+        inline uint64_t neon_mask(uint8x16_t a, uint8x16_t b, uint8x16_t c, uint8x16_t d)
+        {
+            const uint8x16_t weights = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+            uint8x16_t sum0 = vpaddq_u8(vandq_u8(a, weights), vandq_u8(b, weights));
+            uint8x16_t sum1 = vpaddq_u8(vandq_u8(c, weights), vandq_u8(d, weights));
+            sum0 = vpaddq_u8(sum0, sum1);
+            sum0 = vpaddq_u8(sum0, sum0);
+            return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+        }
+
+        BlockMasks classify_neon(const char * block)
+        {
+            uint8x16_t q[4], s[4], o[4], w[4];
+            for (int i = 0; i < 4; ++i)
+            {
+                uint8x16_t c = vld1q_u8(reinterpret_cast<const uint8_t *>(block + i * 16));
+                uint8x16_t folded = vorrq_u8(c, vdupq_n_u8(0x20));
+                q[i] = vceqq_u8(c, vdupq_n_u8('"'));
+                s[i] = vceqq_u8(c, vdupq_n_u8('\\'));
+                o[i] = vorrq_u8(vorrq_u8(vceqq_u8(folded, vdupq_n_u8('{')), vceqq_u8(folded, vdupq_n_u8('}'))),
+                                vorrq_u8(vceqq_u8(c, vdupq_n_u8(':')), vceqq_u8(c, vdupq_n_u8(','))));
+                w[i] = vorrq_u8(vorrq_u8(vceqq_u8(c, vdupq_n_u8(' ')), vceqq_u8(c, vdupq_n_u8('\t'))),
+                                vorrq_u8(vceqq_u8(c, vdupq_n_u8('\n')), vceqq_u8(c, vdupq_n_u8('\r'))));
+            }
+            BlockMasks m;
+            m.quote = neon_mask(q[0], q[1], q[2], q[3]);
+            m.backslash = neon_mask(s[0], s[1], s[2], s[3]);
+            m.op = neon_mask(o[0], o[1], o[2], o[3]);
+            m.whitespace = neon_mask(w[0], w[1], w[2], w[3]);
+            return m;
+        }
+#endif
+
+        typedef BlockMasks (*ClassifyFunc)(const char *);
+
+        // indexes whole blocks while a block's worth of room (64) is left
+        template <ClassifyFunc classify>
+        size_t index_blocks(const char * data, size_t size, size_t & offset, IndexState & state, uint32_t * out, size_t capacity)
+        {
+            uint32_t * begin = out;
+            uint32_t * limit = out + capacity - 64;
+            char tail[64];
+            for (; offset < size && out <= limit; offset += 64)
+            {
+                const char * block = size - offset >= 64 ? data + offset : tail_block(data, size, offset, tail);
+                BlockMasks m = classify(block);
+                uint64_t quote = unescaped_quotes(m, state);
+                out = index_block(m, quote, prefix_xor(quote), state, static_cast<uint32_t>(offset), out);
+            }
+            return static_cast<size_t>(out - begin);
+        }
+
+        struct IndexImpl
+        {
+            size_t (*func)(const char *, size_t, size_t &, IndexState &, uint32_t *, size_t);
+            const char * name;
+        };
+
+        const IndexImpl index_impls[] = {
+#ifdef EASY_JSON_INDEX_AVX2
+            { index_avx2, "avx2" },
+#endif
+#ifdef EASY_JSON_INDEX_SSE2
+            { index_blocks<classify_sse2>, "sse2" },
+#endif
+#ifdef EASY_JSON_INDEX_NEON
+            { index_blocks<classify_neon>, "neon" },
+#endif
+            { index_blocks<classify_scalar>, "scalar" },
+        };
+
+        bool index_impl_supported(const IndexImpl & impl)
+        {
+#ifdef EASY_JSON_INDEX_AVX2
+            if (strcmp(impl.name, "avx2") == 0)
+            {
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("pclmul") &&
+                       __builtin_cpu_supports("popcnt") && __builtin_cpu_supports("bmi");
+            }
+#endif
+            (void)impl;
+            return true;
+        }
+
+        const IndexImpl * select_index()
+        {
+            for (const auto & impl : index_impls)
+            {
+                if (index_impl_supported(impl))
+                    return &impl;
+            }
+            return nullptr;
+        }
+
+        const IndexImpl * index_impl = select_index();
+    } // namespace
+
+    JsonStructuralIndexer::JsonStructuralIndexer(const char * data, size_t size)
+        : _data(data), _size(size)
+    {
+    }
+
+    size_t JsonStructuralIndexer::next(uint32_t * positions, size_t capacity)
+    {
+        if (capacity < MIN_CAPACITY)
+            return 0;
+        return index_impl->func(_data, _size, _offset, _state, positions, capacity);
+    }
+
+    const char * structural_index_impl()
+    {
+        return index_impl->name;
+    }
+
+    bool select_structural_index_impl(const char * name)
+    {
+        for (const auto & impl : index_impls)
+        {
+            if (name != nullptr && strcmp(impl.name, name) == 0 && index_impl_supported(impl))
+            {
+                index_impl = &impl;
+                return true;
+            }
+        }
+        return false;
+    }
+} // namespace easy_json
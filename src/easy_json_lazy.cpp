@@ -0,0 +1,436 @@
+﻿#include "easy_json_lazy.h"
+#include "easy_json_reader.h"
+
+#include <cstring>
+
+namespace easy_json
+{
+    JsonType JsonLazyValue::type() const
+    {
+        return valid() ? _document->_nodes[_node].type : JsonType::Null;
+    }
+
+    std::string_view JsonLazyValue::str_view() const
+    {
+        return is_string() ? _document->_nodes[_node].string : std::string_view();
+    }
+
+    bool JsonLazyValue::to_boolean() const
+    {
+        return is_boolean() && _document->_text[_document->_nodes[_node].begin] == 't';
+    }
+
+    double JsonLazyValue::to_number() const
+    {
+        if (!is_number())
+            return 0.0;
+        const auto & node = _document->_nodes[_node];
+        JsonNumberValue number;
+        parse_number(_document->_text + node.begin, _document->_text + node.end, number);
+        switch (number.type)
+        {
+        case JsonNumberType::Int64:
+            return static_cast<double>(number.i);
+        case JsonNumberType::Uint64:
+            return static_cast<double>(number.u);
+        default:
+            return number.d;
+        }
+    }
+
+    int64_t JsonLazyValue::to_integer() const
+    {
+        if (!is_number())
+            return 0;
+        const auto & node = _document->_nodes[_node];
+        JsonNumberValue number;
+        parse_number(_document->_text + node.begin, _document->_text + node.end, number);
+        switch (number.type)
+        {
+        case JsonNumberType::Int64:
+            return number.i;
+        case JsonNumberType::Uint64:
+            return static_cast<int64_t>(number.u);
+        default:
+            return static_cast<int64_t>(number.d);
+        }
+    }
+
+    uint64_t JsonLazyValue::to_unsigned() const
+    {
+        if (!is_number())
+            return 0;
+        const auto & node = _document->_nodes[_node];
+        JsonNumberValue number;
+        parse_number(_document->_text + node.begin, _document->_text + node.end, number);
+        return number.type == JsonNumberType::Uint64 ? number.u : static_cast<uint64_t>(to_integer());
+    }
+
+    JsonLazyValue JsonLazyValue::get_property(std::string_view key) const
+    {
+        if (!is_object())
+            return JsonLazyValue();
+
+        // the last of duplicate keys wins, as in JsonObject
+        size_t found = SIZE_MAX;
+        for (size_t i = 0;; ++i)
+        {
+            if (i == _document->_nodes[_node].entries.size() && !_document->next_entry(_node))
+                break;
+            if (_document->_nodes[_node].entries[i].key == key)
+                found = i;
+        }
+        if (found == SIZE_MAX)
+            return JsonLazyValue();
+        uint32_t child = _document->child(_node, found);
+        return child == JsonLazyDocument::NONE ? JsonLazyValue() : JsonLazyValue(_document, child);
+    }
+
+    JsonLazyValue JsonLazyValue::at(int index) const
+    {
+        if (!is_array() || index < 0)
+            return JsonLazyValue();
+
+        while (_document->_nodes[_node].entries.size() <= static_cast<size_t>(index))
+        {
+            if (!_document->next_entry(_node))
+                return JsonLazyValue();
+        }
+        uint32_t child = _document->child(_node, index);
+        return child == JsonLazyDocument::NONE ? JsonLazyValue() : JsonLazyValue(_document, child);
+    }
+
+    size_t JsonLazyValue::count() const
+    {
+        if (!is_object() && !is_array())
+            return 0;
+        while (_document->next_entry(_node))
+            ;
+        return _document->_nodes[_node].entries.size();
+    }
+
+    std::string_view JsonLazyValue::raw() const
+    {
+        if (!valid())
+            return std::string_view();
+        size_t end = _document->node_end(_node);
+        size_t begin = _document->_nodes[_node].begin;
+        return end > begin ? std::string_view(_document->_text + begin, end - begin) : std::string_view();
+    }
+
+    JsonLazyDocument::JsonLazyDocument() {}
+
+    JsonLazyDocument::~JsonLazyDocument() {}
+
+    bool JsonLazyDocument::open(const char * str, size_t length)
+    {
+        close();
+        if (str == nullptr)
+            return false;
+        _text = str;
+        _size = length;
+
+        size_t p = 0;
+        if (_size >= 3 &&
+            static_cast<unsigned char>(_text[0]) == 0XEF &&
+            static_cast<unsigned char>(_text[1]) == 0XBB &&
+            static_cast<unsigned char>(_text[2]) == 0XBF) // UTF-8 BOM
+            p = 3;
+        p = skip_space(p);
+        if (p >= _size || (_text[p] != '{' && _text[p] != '['))
+        {
+            fail();
+            return false;
+        }
+        add_node(p);
+        return true;
+    }
+
+    void JsonLazyDocument::close()
+    {
+        _text = nullptr;
+        _size = 0;
+        _failed = false;
+        _nodes.clear();
+        _strings.release();
+    }
+
+    JsonLazyValue JsonLazyDocument::root()
+    {
+        return _nodes.empty() ? JsonLazyValue() : JsonLazyValue(this, 0);
+    }
+
+    // scalars are read completely when visited, containers only on access
+    uint32_t JsonLazyDocument::add_node(size_t offset)
+    {
+        Node node;
+        node.complete = false;
+        node.begin = offset;
+        node.end = 0;
+
+        const char * p = _text + offset;
+        const char * end = _text + _size;
+        switch (*p)
+        {
+        case '{':
+            node.type = JsonType::Object;
+            break;
+        case '[':
+            node.type = JsonType::Array;
+            break;
+        case '\"':
+            node.type = JsonType::String;
+            if (!read_string(offset, node.string))
+                return NONE;
+            node.end = offset;
+            break;
+        case 't':
+        case 'f':
+        case 'n':
+        {
+            const char * literal = *p == 't' ? "true" : *p == 'f' ? "false" : "null";
+            size_t length = strlen(literal);
+            if (static_cast<size_t>(end - p) < length || memcmp(p, literal, length) != 0)
+            {
+                fail();
+                return NONE;
+            }
+            node.type = *p == 'n' ? JsonType::Null : JsonType::Boolean;
+            node.end = offset + length;
+            break;
+        }
+        default:
+        {
+            JsonNumberValue number;
+            const char * number_end = parse_number(p, end, number);
+            if (number_end == nullptr)
+            {
+                fail();
+                return NONE;
+            }
+            node.type = JsonType::Number;
+            node.end = number_end - _text;
+            break;
+        }
+        }
+
+        _nodes.push_back(std::move(node));
+        return static_cast<uint32_t>(_nodes.size() - 1);
+    }
+
+    uint32_t JsonLazyDocument::child(uint32_t node, size_t index)
+    {
+        uint32_t id = _nodes[node].entries[index].node;
+        if (id == NONE)
+        {
+            id = add_node(_nodes[node].entries[index].value);
+            _nodes[node].entries[index].node = id;
+        }
+        return id;
+    }
+
+    // reads the next member of a container, false at its end or on errors
+    bool JsonLazyDocument::next_entry(uint32_t node)
+    {
+        if (_nodes[node].complete || _failed)
+            return false;
+
+        size_t p;
+        bool first = _nodes[node].entries.empty();
+        if (first)
+        {
+            p = _nodes[node].begin + 1;
+        }
+        else
+        {
+            const Entry & last = _nodes[node].entries.back();
+            p = last.node != NONE ? node_end(last.node) : value_end(last.value);
+            if (p == 0)
+                return false;
+        }
+
+        Node & n = _nodes[node];
+        p = skip_space(p);
+        if (p >= _size)
+        {
+            fail();
+            return false;
+        }
+        if (_text[p] == (n.type == JsonType::Object ? '}' : ']'))
+        {
+            n.complete = true;
+            n.end = p + 1;
+            return false;
+        }
+        if (!first)
+        {
+            if (_text[p] != ',')
+            {
+                fail();
+                return false;
+            }
+            p = skip_space(p + 1);
+        }
+
+        Entry entry;
+        entry.node = NONE;
+        if (n.type == JsonType::Object)
+        {
+            if (p >= _size || _text[p] != '\"' || !read_string(p, entry.key))
+            {
+                fail();
+                return false;
+            }
+            p = skip_space(p);
+            if (p >= _size || _text[p] != ':')
+            {
+                fail();
+                return false;
+            }
+            p = skip_space(p + 1);
+        }
+        if (p >= _size)
+        {
+            fail();
+            return false;
+        }
+        entry.value = p;
+        n.entries.push_back(entry);
+        return true;
+    }
+
+    // offset past a visited value, containers are bracket matched from the
+    // last member read so far
+    size_t JsonLazyDocument::node_end(uint32_t node)
+    {
+        if (_nodes[node].end != 0)
+            return _nodes[node].end;
+
+        size_t p = _nodes[node].begin + 1;
+        if (!_nodes[node].entries.empty())
+        {
+            const Entry & last = _nodes[node].entries.back();
+            p = last.node != NONE ? node_end(last.node) : value_end(last.value);
+            if (p == 0)
+                return 0;
+        }
+        _nodes[node].end = skip_container(p);
+        return _nodes[node].end;
+    }
+
+    size_t JsonLazyDocument::value_end(size_t offset)
+    {
+        switch (_text[offset])
+        {
+        case '\"':
+            return skip_string(offset);
+        case '{':
+        case '[':
+            return skip_container(offset + 1);
+        default:
+            // numbers and literals end at the first delimiter
+            while (offset < _size)
+            {
+                char c = _text[offset];
+                if (c == ',' || c == '}' || c == ']' || c == ' ' || c == '\n' || c == '\r' || c == '\t')
+                    break;
+                ++offset;
+            }
+            return offset;
+        }
+    }
+
+    size_t JsonLazyDocument::skip_space(size_t offset) const
+    {
+        while (offset < _size)
+        {
+            char c = _text[offset];
+            if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+                break;
+            ++offset;
+        }
+        return offset;
+    }
+
+    size_t JsonLazyDocument::skip_string(size_t offset)
+    {
+        const char * end = _text + _size;
+        const char * p = _text + offset + 1;
+        while (true)
+        {
+            p = scan_string(p, end);
+            if (p >= end)
+                break;
+            if (*p == '\"')
+                return p + 1 - _text;
+            p += 2;    // the escaped character
+        }
+        fail();
+        return 0;
+    }
+
+    // offset is inside a container, past its opening bracket and outside of
+    // strings. The structural index finds the brackets one block at a time.
+    size_t JsonLazyDocument::skip_container(size_t offset)
+    {
+        size_t remaining = _size - offset;
+        JsonStructuralIndexer indexer(_text + offset, remaining < UINT32_MAX ? remaining : UINT32_MAX);
+        uint32_t positions[JsonStructuralIndexer::MIN_CAPACITY];
+        int depth = 1;
+        while (size_t count = indexer.next(positions, JsonStructuralIndexer::MIN_CAPACITY))
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                char c = _text[offset + positions[i]];
+                if (c == '{' || c == '[')
+                    ++depth;
+                else if ((c == '}' || c == ']') && --depth == 0)
+                    return offset + positions[i] + 1;
+            }
+        }
+        fail();
+        return 0;
+    }
+
+    // offset is at the opening quote and moves past the closing one, escaped
+    // strings are decoded into the document
+    bool JsonLazyDocument::read_string(size_t & offset, std::string_view & value)
+    {
+        const char * end = _text + _size;
+        const char * begin = _text + offset + 1;
+        const char * p = scan_string(begin, end);
+        if (p < end && *p == '\"')
+        {
+            value = std::string_view(begin, p - begin);
+            offset = p + 1 - _text;
+            return true;
+        }
+
+        _buffer.assign(begin, p - begin);
+        while (true)
+        {
+            if (p >= end)
+            {
+                fail();
+                return false;
+            }
+            if (*p == '\"')
+                break;
+            p = decode_escape(p, end, _buffer);
+            if (p == nullptr)
+            {
+                fail();
+                return false;
+            }
+            const char * run_end = scan_string(p, end);
+            _buffer.append(p, run_end - p);
+            p = run_end;
+        }
+        offset = p + 1 - _text;
+
+        char * copy = static_cast<char *>(_strings.allocate(_buffer.size() + 1, 1));
+        memcpy(copy, _buffer.data(), _buffer.size());
+        value = std::string_view(copy, _buffer.size());
+        return true;
+    }
+} // namespace easy_json
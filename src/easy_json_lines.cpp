@@ -0,0 +1,284 @@
+﻿#include "easy_json_lines.h"
+#include "easy_json_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace easy_json
+{
+    namespace
+    {
+        // task queue of one worker, the owner pops from the front and idle
+        // workers steal from the back
+        struct WorkQueue
+        {
+            std::mutex lock;
+            std::deque<size_t> tasks;
+
+            bool pop(size_t & task)
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (tasks.empty())
+                    return false;
+                task = tasks.front();
+                tasks.pop_front();
+                return true;
+            }
+
+            bool steal(size_t & task)
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (tasks.empty())
+                    return false;
+                task = tasks.back();
+                tasks.pop_back();
+                return true;
+            }
+        };
+
+        bool is_blank(const char * p, const char * end)
+        {
+            for (; p < end; ++p)
+            {
+                if (*p != ' ' && *p != '\t' && *p != '\r')
+                    return false;
+            }
+            return true;
+        }
+
+        // arena sized from the line so small records do not each take a 4K block
+        size_t block_size_for(size_t length)
+        {
+            return std::min<size_t>(std::max<size_t>(length * 2, 512), 1024 * 1024);
+        }
+    } // namespace
+
+    JsonLinesParser::JsonLinesParser() {}
+
+    JsonLinesParser::JsonLinesParser(const Options & options) : _options(options)
+    {
+        if (_options.chunk_size == 0)
+            _options.chunk_size = 1;
+    }
+
+    unsigned JsonLinesParser::thread_count() const
+    {
+        unsigned threads = _options.threads ? _options.threads : std::thread::hardware_concurrency();
+        return std::max(threads, 1u);
+    }
+
+    template <typename Task>
+    void JsonLinesParser::run(size_t task_count, const Task & task)
+    {
+        unsigned threads = static_cast<unsigned>(std::min<size_t>(thread_count(), task_count));
+        if (threads <= 1)
+        {
+            for (size_t i = 0; i < task_count; ++i)
+                task(i, 0u);
+            return;
+        }
+
+        // contiguous ranges per worker keep neighbouring chunks on one thread
+        std::vector<WorkQueue> queues(threads);
+        for (size_t i = 0; i < task_count; ++i)
+            queues[i * threads / task_count].tasks.push_back(i);
+
+        std::exception_ptr failure;
+        std::mutex failure_lock;
+        auto worker = [&](unsigned id) {
+            try
+            {
+                size_t index;
+                while (true)
+                {
+                    bool found = queues[id].pop(index);
+                    for (unsigned k = 1; !found && k < threads; ++k)
+                        found = queues[(id + k) % threads].steal(index);
+                    if (!found)
+                        break;
+                    task(index, id);
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> guard(failure_lock);
+                if (!failure)
+                    failure = std::current_exception();
+            }
+        };
+
+        std::vector<std::thread> pool;
+        pool.reserve(threads - 1);
+        for (unsigned id = 1; id < threads; ++id)
+            pool.emplace_back(worker, id);
+        worker(0);
+        for (auto & thread : pool)
+            thread.join();
+        if (failure)
+            std::rethrow_exception(failure);
+    }
+
+    void JsonLinesParser::split(const char * data, size_t size)
+    {
+        _chunks.clear();
+        _lines = 0;
+        _failures = 0;
+        if (data == nullptr || size == 0)
+            return;
+
+        // chunk boundaries are the first newline past every chunk_size bytes
+        const char * end = data + size;
+        const char * p = data;
+        while (p < end)
+        {
+            const char * cut = end;
+            if (static_cast<size_t>(end - p) > _options.chunk_size)
+            {
+                auto * nl = static_cast<const char *>(memchr(p + _options.chunk_size - 1, '\n', end - p - _options.chunk_size + 1));
+                if (nl != nullptr)
+                    cut = nl + 1;
+            }
+            _chunks.push_back(Chunk{ p, cut, 0, 0 });
+            p = cut;
+        }
+
+        // line numbers need the line count of every preceding chunk
+        run(_chunks.size(), [this](size_t index, unsigned) {
+            Chunk & chunk = _chunks[index];
+            size_t count = 0;
+            for (const char * q = chunk.begin; q < chunk.end; ++count)
+            {
+                auto * nl = static_cast<const char *>(memchr(q, '\n', chunk.end - q));
+                q = nl ? nl + 1 : chunk.end;
+            }
+            chunk.line_count = count;
+        });
+        for (auto & chunk : _chunks)
+        {
+            chunk.first_line = _lines;
+            _lines += chunk.line_count;
+        }
+    }
+
+    std::vector<JsonLinesParser::Record> JsonLinesParser::parse(const char * data, size_t size)
+    {
+        split(data, size);
+        std::vector<std::vector<Record>> parts(_chunks.size());
+        std::vector<size_t> failures(_chunks.size());
+
+        run(_chunks.size(), [&](size_t index, unsigned) {
+            const Chunk & chunk = _chunks[index];
+            size_t line = chunk.first_line;
+            for (const char * p = chunk.begin; p < chunk.end; ++line)
+            {
+                auto * nl = static_cast<const char *>(memchr(p, '\n', chunk.end - p));
+                const char * line_end = nl ? nl : chunk.end;
+                if (!is_blank(p, line_end))
+                {
+                    Record record;
+                    record.line = line;
+                    record.offset = static_cast<size_t>(p - data);
+                    size_t length = static_cast<size_t>(line_end - p);
+                    auto document = std::make_unique<JsonDocument>(std::pmr::get_default_resource(), block_size_for(length));
+                    record.ok = document->parse(p, length, _options.flags);
+                    if (record.ok)
+                    {
+                        record.document = std::move(document);
+                    }
+                    else
+                    {
+                        record.error = document->error();
+                        record.error_offset = document->error_offset();
+                        ++failures[index];
+                    }
+                    parts[index].push_back(std::move(record));
+                }
+                p = line_end + 1;
+            }
+        });
+
+        std::vector<Record> records;
+        size_t total = 0;
+        for (auto & part : parts)
+            total += part.size();
+        records.reserve(total);
+        for (size_t i = 0; i < parts.size(); ++i)
+        {
+            std::move(parts[i].begin(), parts[i].end(), std::back_inserter(records));
+            _failures += failures[i];
+        }
+        return records;
+    }
+
+    bool JsonLinesParser::parse(const char * data, size_t size, const Callback & callback)
+    {
+        split(data, size);
+        unsigned threads = static_cast<unsigned>(std::min<size_t>(thread_count(), std::max<size_t>(_chunks.size(), 1)));
+        std::vector<std::unique_ptr<JsonDocument>> documents(threads);
+        std::vector<size_t> failures(threads);
+
+        run(_chunks.size(), [&](size_t index, unsigned worker) {
+            const Chunk & chunk = _chunks[index];
+            if (!documents[worker])
+                documents[worker] = std::make_unique<JsonDocument>();
+            JsonDocument & document = *documents[worker];
+
+            size_t line = chunk.first_line;
+            for (const char * p = chunk.begin; p < chunk.end; ++line)
+            {
+                auto * nl = static_cast<const char *>(memchr(p, '\n', chunk.end - p));
+                const char * line_end = nl ? nl : chunk.end;
+                if (!is_blank(p, line_end))
+                {
+                    Record record;
+                    record.line = line;
+                    record.offset = static_cast<size_t>(p - data);
+                    size_t length = static_cast<size_t>(line_end - p);
+                    record.ok = document.parse(p, length, _options.flags);
+                    if (!record.ok)
+                    {
+                        record.error = document.error();
+                        record.error_offset = document.error_offset();
+                        ++failures[worker];
+                    }
+                    callback(record, record.ok ? &document : nullptr);
+                }
+                p = line_end + 1;
+            }
+        });
+
+        for (size_t count : failures)
+            _failures += count;
+        return _failures == 0;
+    }
+
+    std::vector<JsonLinesParser::Record> JsonLinesParser::parse_file(const char * path)
+    {
+        JsonMappedFile file;
+        if (!file.open(path))
+        {
+            split(nullptr, 0);
+            return {};
+        }
+        uint32_t flags = _options.flags;
+        _options.flags &= ~JSON_PARSE_BORROW_INPUT;
+        auto records = parse(file.data(), file.size());
+        _options.flags = flags;
+        return records;
+    }
+
+    bool JsonLinesParser::parse_file(const char * path, const Callback & callback)
+    {
+        JsonMappedFile file;
+        if (!file.open(path))
+        {
+            split(nullptr, 0);
+            return false;
+        }
+        return parse(file.data(), file.size(), callback);
+    }
+} // namespace easy_json
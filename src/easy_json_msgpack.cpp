@@ -0,0 +1,524 @@
+﻿#include "easy_json.h"
+#include "easy_json_msgpack.h"
+#include "easy_json_dom.h"
+
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace easy_json
+{
+    namespace
+    {
+        uint64_t load_be(const uint8_t * p, int bytes)
+        {
+            uint64_t value = 0;
+            for (int i = 0; i < bytes; ++i)
+                value = (value << 8) | p[i];
+            return value;
+        }
+
+        // tag followed by the low `bytes` bytes of value, big endian
+        void put_be(std::string & out, uint8_t tag, uint64_t value, int bytes)
+        {
+            char buf[9];
+            buf[0] = static_cast<char>(tag);
+            for (int i = bytes; i > 0; --i)
+            {
+                buf[i] = static_cast<char>(value & 0xff);
+                value >>= 8;
+            }
+            out.append(buf, bytes + 1);
+        }
+
+        void put_length(std::string & out, uint64_t length, uint8_t fix, uint32_t fix_limit, uint8_t tag8, uint8_t tag16)
+        {
+            if (length < fix_limit)
+                out.push_back(static_cast<char>(fix | length));
+            else if (tag8 != 0 && length <= 0xff)
+                put_be(out, tag8, length, 1);
+            else if (length <= 0xffff)
+                put_be(out, tag16, length, 2);
+            else
+                put_be(out, tag16 + 1, length, 4);
+        }
+
+        void put_unsigned(std::string & out, uint64_t value)
+        {
+            if (value < 0x80)
+                out.push_back(static_cast<char>(value));
+            else if (value <= 0xff)
+                put_be(out, 0xcc, value, 1);
+            else if (value <= 0xffff)
+                put_be(out, 0xcd, value, 2);
+            else if (value <= 0xffffffffu)
+                put_be(out, 0xce, value, 4);
+            else
+                put_be(out, 0xcf, value, 8);
+        }
+
+        void put_integer(std::string & out, int64_t value)
+        {
+            if (value >= 0)
+                put_unsigned(out, static_cast<uint64_t>(value));
+            else if (value >= -32)
+                out.push_back(static_cast<char>(value));
+            else if (value >= INT8_MIN)
+                put_be(out, 0xd0, static_cast<uint64_t>(value), 1);
+            else if (value >= INT16_MIN)
+                put_be(out, 0xd1, static_cast<uint64_t>(value), 2);
+            else if (value >= INT32_MIN)
+                put_be(out, 0xd2, static_cast<uint64_t>(value), 4);
+            else
+                put_be(out, 0xd3, static_cast<uint64_t>(value), 8);
+        }
+
+        void put_double(std::string & out, double value)
+        {
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            put_be(out, 0xcb, bits, 8);
+        }
+
+        void put_number(std::string & out, const JsonAny * value)
+        {
+            switch (value->number_type())
+            {
+            case JsonNumberType::Int64:
+                put_integer(out, value->to_integer());
+                return;
+            case JsonNumberType::Uint64:
+                put_unsigned(out, value->to_unsigned());
+                return;
+            case JsonNumberType::Raw:
+            {
+                // raw text has no MessagePack form, it is stored as the value
+                // it parses to: integers exactly, everything else as a double
+                std::string_view text = value->number_text();
+                JsonNumberValue number;
+                if (parse_number(text.data(), text.data() + text.size(), number) == nullptr)
+                    put_double(out, 0.0);
+                else if (number.type == JsonNumberType::Int64)
+                    put_integer(out, number.i);
+                else if (number.type == JsonNumberType::Uint64)
+                    put_unsigned(out, number.u);
+                else
+                    put_double(out, number.d);
+                return;
+            }
+            default:
+                put_double(out, value->to_number());
+                return;
+            }
+        }
+
+        void put_string(std::string & out, std::string_view value)
+        {
+            put_length(out, value.size(), 0xa0, 32, 0xd9, 0xda);
+            out.append(value.data(), value.size());
+        }
+
+        void encode(std::string & out, const JsonAny * value)
+        {
+            switch (value->type())
+            {
+            case JsonType::Boolean:
+                out.push_back(static_cast<char>(value->to_boolean() ? 0xc3 : 0xc2));
+                break;
+            case JsonType::Number:
+                put_number(out, value);
+                break;
+            case JsonType::String:
+                put_string(out, value->str_view());
+                break;
+            case JsonType::Object:
+            {
+                const JsonObject * obj = value->to_object();
+                size_t count = obj->count();
+                put_length(out, count, 0x80, 16, 0, 0xde);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    put_string(out, obj->key_view_at(static_cast<int>(i)));
+                    JsonAny * member = obj->value_at(static_cast<int>(i));
+                    if (member)
+                        encode(out, member);
+                    else
+                        out.push_back(static_cast<char>(0xc0));
+                }
+                break;
+            }
+            case JsonType::Array:
+            {
+                const JsonArray * arr = value->to_array();
+                size_t count = arr->count();
+                put_length(out, count, 0x90, 16, 0, 0xdc);
+                // packed columns are encoded without making element nodes
+                JsonColumn column = arr->column();
+                if (const double * doubles = column.doubles())
+                {
+                    for (size_t i = 0; i < count; ++i)
+                        put_double(out, doubles[i]);
+                    break;
+                }
+                if (const int64_t * integers = column.integers())
+                {
+                    for (size_t i = 0; i < count; ++i)
+                        put_integer(out, integers[i]);
+                    break;
+                }
+                for (size_t i = 0; i < count; ++i)
+                {
+                    JsonAny * item = arr->at(static_cast<int>(i));
+                    if (item)
+                        encode(out, item);
+                    else
+                        out.push_back(static_cast<char>(0xc0));
+                }
+                break;
+            }
+            default:
+                out.push_back(static_cast<char>(0xc0));
+                break;
+            }
+        }
+
+        bool equal(const uint8_t * p, size_t length, std::string_view key)
+        {
+            return length == key.size() && (length == 0 || memcmp(p, key.data(), length) == 0);
+        }
+    } // namespace
+
+    const uint8_t * msgpack_header(const uint8_t * p, const uint8_t * end, JsonMsgPackHeader & header)
+    {
+        if (p == nullptr || p >= end)
+            return nullptr;
+
+        uint8_t tag = *p++;
+        if (tag < 0x80)
+        {
+            header.kind = JsonMsgPackKind::Uint;
+            header.value = tag;
+            return p;
+        }
+        if (tag >= 0xe0)
+        {
+            header.kind = JsonMsgPackKind::Int;
+            header.value = static_cast<uint64_t>(static_cast<int64_t>(static_cast<int8_t>(tag)));
+            return p;
+        }
+        if (tag < 0xc0)
+        {
+            static const JsonMsgPackKind fix_kinds[] = { JsonMsgPackKind::Map, JsonMsgPackKind::Array,
+                                                         JsonMsgPackKind::String, JsonMsgPackKind::String };
+            header.kind = fix_kinds[(tag >> 4) & 0x3];
+            header.value = tag < 0xa0 ? (tag & 0x0f) : (tag & 0x1f);
+            return p;
+        }
+
+        // fixed size field following the tag
+        int bytes = 0;
+        switch (tag)
+        {
+        case 0xc0:
+            header.kind = JsonMsgPackKind::Nil;
+            return p;
+        case 0xc2:
+            header.kind = JsonMsgPackKind::False;
+            return p;
+        case 0xc3:
+            header.kind = JsonMsgPackKind::True;
+            return p;
+        case 0xc4: case 0xc5: case 0xc6:
+            header.kind = JsonMsgPackKind::Binary;
+            bytes = 1 << (tag - 0xc4);
+            break;
+        case 0xc7: case 0xc8: case 0xc9:
+            header.kind = JsonMsgPackKind::Ext;
+            bytes = 1 << (tag - 0xc7);
+            break;
+        case 0xca:
+            header.kind = JsonMsgPackKind::Float32;
+            bytes = 4;
+            break;
+        case 0xcb:
+            header.kind = JsonMsgPackKind::Float64;
+            bytes = 8;
+            break;
+        case 0xcc: case 0xcd: case 0xce: case 0xcf:
+            header.kind = JsonMsgPackKind::Uint;
+            bytes = 1 << (tag - 0xcc);
+            break;
+        case 0xd0: case 0xd1: case 0xd2: case 0xd3:
+            header.kind = JsonMsgPackKind::Int;
+            bytes = 1 << (tag - 0xd0);
+            break;
+        case 0xd4: case 0xd5: case 0xd6: case 0xd7: case 0xd8:
+            header.kind = JsonMsgPackKind::Ext;
+            header.value = 1 + (1u << (tag - 0xd4));
+            return p;
+        case 0xd9: case 0xda: case 0xdb:
+            header.kind = JsonMsgPackKind::String;
+            bytes = 1 << (tag - 0xd9);
+            break;
+        case 0xdc: case 0xdd:
+            header.kind = JsonMsgPackKind::Array;
+            bytes = 2 << (tag - 0xdc);
+            break;
+        case 0xde: case 0xdf:
+            header.kind = JsonMsgPackKind::Map;
+            bytes = 2 << (tag - 0xde);
+            break;
+        default:
+            header.kind = JsonMsgPackKind::Invalid;
+            return nullptr;
+        }
+
+        if (end - p < bytes)
+            return nullptr;
+        header.value = load_be(p, bytes);
+        if (header.kind == JsonMsgPackKind::Int && bytes < 8)
+        {
+            // sign extend
+            int shift = 64 - bytes * 8;
+            header.value = static_cast<uint64_t>(static_cast<int64_t>(header.value << shift) >> shift);
+        }
+        else if (header.kind == JsonMsgPackKind::Ext)
+            header.value += 1;
+        return p + bytes;
+    }
+
+    const uint8_t * msgpack_skip(const uint8_t * p, const uint8_t * end)
+    {
+        // values still to skip, containers add their children
+        uint64_t pending = 1;
+        while (pending > 0)
+        {
+            JsonMsgPackHeader header;
+            p = msgpack_header(p, end, header);
+            if (p == nullptr)
+                return nullptr;
+            --pending;
+
+            uint64_t remain = static_cast<uint64_t>(end - p);
+            switch (header.kind)
+            {
+            case JsonMsgPackKind::String:
+            case JsonMsgPackKind::Binary:
+            case JsonMsgPackKind::Ext:
+                if (remain < header.value)
+                    return nullptr;
+                p += header.value;
+                break;
+            case JsonMsgPackKind::Array:
+            case JsonMsgPackKind::Map:
+            {
+                // every child takes a byte at least, which also bounds pending
+                uint64_t children = header.kind == JsonMsgPackKind::Map ? header.value * 2 : header.value;
+                if (children > remain)
+                    return nullptr;
+                pending += children;
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        return p;
+    }
+
+    std::string JsonAny::dump_msgpack() const
+    {
+        std::string out;
+        dump_msgpack(out);
+        return out;
+    }
+
+    void JsonAny::dump_msgpack(std::string & out) const
+    {
+        encode(out, this);
+    }
+
+    JsonAny * JsonAny::parse_msgpack(const char * data, size_t length)
+    {
+        JsonDomBuilder builder(nullptr, JSON_PARSE_DEFAULT);
+        JsonMsgPackReader<JsonDomBuilder> reader(data, length);
+        if (!reader.parse(builder))
+        {
+            JsonAny::destroy(builder.result());
+            return nullptr;
+        }
+        return builder.result();
+    }
+
+    bool JsonDocument::parse_msgpack(const char * data, size_t length, uint32_t flags)
+    {
+        reset();
+        flags &= ~JSON_PARSE_RAW_NUMBERS;
+        auto & builder = parse_cache().builder;
+        builder.reset(this, flags);
+        JsonMsgPackReader<JsonDomBuilder> reader(data, length, flags);
+        reader.set_limits(_limits);
+        bool ok = reader.parse(builder);
+        _error = reader.error();
+        _error_offset = reader.offset();
+        return finish_parse(ok, builder);
+    }
+
+    // In place view
+    JsonMsgPackValue::JsonMsgPackValue(const char * data, size_t size)
+    {
+        if (data != nullptr && size > 0)
+        {
+            _p = reinterpret_cast<const uint8_t *>(data);
+            _end = _p + size;
+        }
+    }
+
+    JsonMsgPackHeader JsonMsgPackValue::header(const uint8_t ** payload) const
+    {
+        JsonMsgPackHeader result;
+        const uint8_t * p = msgpack_header(_p, _end, result);
+        if (p == nullptr)
+            result.kind = JsonMsgPackKind::Invalid;
+        if (payload)
+            *payload = p;
+        return result;
+    }
+
+    JsonMsgPackValue JsonMsgPackValue::child(const uint8_t * p) const
+    {
+        // a truncated header makes the member missing
+        JsonMsgPackHeader h;
+        return msgpack_header(p, _end, h) != nullptr ? JsonMsgPackValue(p, _end) : JsonMsgPackValue();
+    }
+
+    JsonType JsonMsgPackValue::type() const
+    {
+        switch (header().kind)
+        {
+        case JsonMsgPackKind::False:
+        case JsonMsgPackKind::True:
+            return JsonType::Boolean;
+        case JsonMsgPackKind::Int:
+        case JsonMsgPackKind::Uint:
+        case JsonMsgPackKind::Float32:
+        case JsonMsgPackKind::Float64:
+            return JsonType::Number;
+        case JsonMsgPackKind::String:
+            return JsonType::String;
+        case JsonMsgPackKind::Map:
+            return JsonType::Object;
+        case JsonMsgPackKind::Array:
+            return JsonType::Array;
+        default:
+            return JsonType::Null;
+        }
+    }
+
+    std::string_view JsonMsgPackValue::str_view() const
+    {
+        const uint8_t * payload;
+        JsonMsgPackHeader h = header(&payload);
+        if (h.kind != JsonMsgPackKind::String || static_cast<uint64_t>(_end - payload) < h.value)
+            return std::string_view();
+        return std::string_view(reinterpret_cast<const char *>(payload), static_cast<size_t>(h.value));
+    }
+
+    bool JsonMsgPackValue::to_boolean() const
+    {
+        return header().kind == JsonMsgPackKind::True;
+    }
+
+    int64_t JsonMsgPackValue::to_integer() const
+    {
+        JsonMsgPackHeader h = header();
+        if (h.kind == JsonMsgPackKind::Int || h.kind == JsonMsgPackKind::Uint)
+            return static_cast<int64_t>(h.value);
+        return static_cast<int64_t>(to_number());
+    }
+
+    uint64_t JsonMsgPackValue::to_unsigned() const
+    {
+        JsonMsgPackHeader h = header();
+        if (h.kind == JsonMsgPackKind::Uint)
+            return h.value;
+        return static_cast<uint64_t>(to_integer());
+    }
+
+    double JsonMsgPackValue::to_number() const
+    {
+        JsonMsgPackHeader h = header();
+        switch (h.kind)
+        {
+        case JsonMsgPackKind::Int:
+            return static_cast<double>(static_cast<int64_t>(h.value));
+        case JsonMsgPackKind::Uint:
+            return static_cast<double>(h.value);
+        case JsonMsgPackKind::Float32:
+        {
+            float f;
+            uint32_t bits = static_cast<uint32_t>(h.value);
+            memcpy(&f, &bits, sizeof(f));
+            return f;
+        }
+        case JsonMsgPackKind::Float64:
+        {
+            double d;
+            memcpy(&d, &h.value, sizeof(d));
+            return d;
+        }
+        default:
+            return 0.0;
+        }
+    }
+
+    size_t JsonMsgPackValue::count() const
+    {
+        JsonMsgPackHeader h = header();
+        if (h.kind == JsonMsgPackKind::Array || h.kind == JsonMsgPackKind::Map)
+            return static_cast<size_t>(h.value);
+        return 0;
+    }
+
+    JsonMsgPackValue JsonMsgPackValue::get_property(std::string_view key) const
+    {
+        const uint8_t * p;
+        JsonMsgPackHeader h = header(&p);
+        if (h.kind != JsonMsgPackKind::Map)
+            return JsonMsgPackValue();
+
+        for (uint64_t i = 0; i < h.value && p != nullptr; ++i)
+        {
+            JsonMsgPackHeader key_header;
+            const uint8_t * name = msgpack_header(p, _end, key_header);
+            if (name != nullptr && key_header.kind == JsonMsgPackKind::String &&
+                static_cast<uint64_t>(_end - name) >= key_header.value &&
+                equal(name, static_cast<size_t>(key_header.value), key))
+            {
+                return child(name + key_header.value);
+            }
+            p = msgpack_skip(msgpack_skip(p, _end), _end);
+        }
+        return JsonMsgPackValue();
+    }
+
+    JsonMsgPackValue JsonMsgPackValue::at(int index) const
+    {
+        const uint8_t * p;
+        JsonMsgPackHeader h = header(&p);
+        if (h.kind != JsonMsgPackKind::Array || index < 0 || static_cast<uint64_t>(index) >= h.value)
+            return JsonMsgPackValue();
+
+        for (int i = 0; i < index && p != nullptr; ++i)
+            p = msgpack_skip(p, _end);
+        return child(p);
+    }
+
+    std::string_view JsonMsgPackValue::raw() const
+    {
+        const uint8_t * end = msgpack_skip(_p, _end);
+        if (end == nullptr)
+            return std::string_view();
+        return std::string_view(reinterpret_cast<const char *>(_p), end - _p);
+    }
+} // namespace easy_json
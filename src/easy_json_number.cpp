@@ -0,0 +1,222 @@
+﻿#include "easy_json_number.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace easy_json
+{
+    namespace
+    {
+        inline bool is_digit(char c) { return static_cast<unsigned char>(c - '0') < 10; }
+
+        // every power of ten up to 1e22 is exact in a double
+        const double exact_pow10[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+        };
+
+        char * format_integer(char * buf, uint64_t value, bool negative)
+        {
+            char tmp[24];
+            char * p = tmp + sizeof(tmp);
+            do
+            {
+                *--p = static_cast<char>('0' + value % 10);
+                value /= 10;
+            } while (value != 0);
+            if (negative)
+                *buf++ = '-';
+            size_t n = tmp + sizeof(tmp) - p;
+            memcpy(buf, p, n);
+            return buf + n;
+        }
+
+        // magnitude is the count of significant digits plus the exponent, the
+        // power of ten just above the value
+        double slow_double(const char * begin, const char * end, bool negative, int64_t magnitude)
+        {
+#if defined(__cpp_lib_to_chars) || (defined(__GLIBCXX__) && __GNUC__ >= 11) || (defined(_MSC_VER) && _MSC_VER >= 1924)
+            double ret = 0;
+            if (std::from_chars(begin, end, ret).ec == std::errc::result_out_of_range)
+            {
+                // from_chars leaves the value untouched, saturate like strtod
+                ret = magnitude > 0 ? HUGE_VAL : 0.0;
+                return negative ? -ret : ret;
+            }
+            return ret;
+#else
+            // no floating point from_chars, strtod on a copy bounded to the number
+            std::string tmp(begin, end);
+            return strtod(tmp.c_str(), nullptr);
+#endif
+        }
+    } // namespace
+
+    const char * parse_number(const char * p, const char * end, JsonNumberValue & value)
+    {
+        const char * begin = p;
+        bool negative = false;
+        if (p < end && *p == '-')
+        {
+            negative = true;
+            ++p;
+        }
+
+        const char * digits = p;
+        uint64_t mantissa = 0;
+        if (p < end && *p == '0')
+        {
+            ++p;
+        }
+        else
+        {
+            while (p < end && is_digit(*p))
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p++ - '0');
+        }
+        if (p == digits)
+            return nullptr;
+
+        size_t int_digits = p - digits;
+        int64_t exponent = 0;
+        size_t frac_digits = 0;
+        bool is_float = false;
+
+        if (p < end && *p == '.')
+        {
+            is_float = true;
+            const char * frac = ++p;
+            while (p < end && is_digit(*p))
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p++ - '0');
+            frac_digits = p - frac;
+            if (frac_digits == 0)
+                return nullptr;
+            exponent = -static_cast<int64_t>(frac_digits);
+        }
+
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            is_float = true;
+            ++p;
+            bool exp_negative = false;
+            if (p < end && (*p == '+' || *p == '-'))
+                exp_negative = *p++ == '-';
+
+            const char * exp_digits = p;
+            int64_t exp_value = 0;
+            while (p < end && is_digit(*p))
+            {
+                if (exp_value < 100000)
+                    exp_value = exp_value * 10 + (*p - '0');
+                ++p;
+            }
+            if (p == exp_digits)
+                return nullptr;
+            exponent += exp_negative ? -exp_value : exp_value;
+        }
+
+        // the mantissa may have wrapped past 19 significant digits
+        size_t significant = int_digits + frac_digits;
+        if (significant > 19)
+        {
+            // leading zeros of "0.000..." do not count
+            const char * q = digits;
+            while (q < p && (*q == '0' || *q == '.'))
+            {
+                if (*q == '0')
+                    --significant;
+                ++q;
+            }
+        }
+
+        if (!is_float && significant <= 19)
+        {
+            if (!negative)
+            {
+                if (mantissa <= static_cast<uint64_t>(INT64_MAX))
+                {
+                    value.type = JsonNumberType::Int64;
+                    value.i = static_cast<int64_t>(mantissa);
+                }
+                else
+                {
+                    value.type = JsonNumberType::Uint64;
+                    value.u = mantissa;
+                }
+                return p;
+            }
+            if (mantissa <= static_cast<uint64_t>(INT64_MAX) + 1)
+            {
+                value.type = JsonNumberType::Int64;
+                value.i = static_cast<int64_t>(0 - mantissa);
+                return p;
+            }
+        }
+        else if (!is_float && significant == 20 && !negative && int_digits == 20 && digits[0] == '1')
+        {
+            // 20 digit integers starting with 1 still fit a uint64 unless they wrapped
+            if (mantissa >= 10000000000000000000ull)
+            {
+                value.type = JsonNumberType::Uint64;
+                value.u = mantissa;
+                return p;
+            }
+        }
+
+        value.type = JsonNumberType::Double;
+
+        // Clinger's fast path: both operands exact, one correctly rounded operation
+        if (significant <= 19 && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22)
+        {
+            double d = static_cast<double>(mantissa);
+            d = exponent < 0 ? d / exact_pow10[-exponent] : d * exact_pow10[exponent];
+            value.d = negative ? -d : d;
+            return p;
+        }
+
+        // leading zeros not stripped below 20 digits cannot move an out of
+        // range value across 1
+        value.d = slow_double(begin, p, negative, static_cast<int64_t>(significant) + exponent);
+        return p;
+    }
+
+    char * format_number(char * buf, int64_t value)
+    {
+        uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+        return format_integer(buf, magnitude, value < 0);
+    }
+
+    char * format_number(char * buf, uint64_t value)
+    {
+        return format_integer(buf, value, false);
+    }
+
+    char * format_number(char * buf, double value)
+    {
+        if (!std::isfinite(value))
+        {
+            memcpy(buf, "null", 4);
+            return buf + 4;
+        }
+
+        // integral values print as integers, 2^53 keeps them exact
+        if (value >= -9007199254740992.0 && value <= 9007199254740992.0)
+        {
+            auto integral = static_cast<int64_t>(value);
+            if (static_cast<double>(integral) == value && !(integral == 0 && std::signbit(value)))
+                return format_number(buf, integral);
+        }
+
+#if defined(__cpp_lib_to_chars) || (defined(__GLIBCXX__) && __GNUC__ >= 11) || (defined(_MSC_VER) && _MSC_VER >= 1924)
+        // shortest round trip representation (Ryu in the standard libraries)
+        return std::to_chars(buf, buf + NUMBER_BUFFER_SIZE, value).ptr;
+#else
+        // 17 significant digits always round trip, just not the shortest
+        int n = snprintf(buf, NUMBER_BUFFER_SIZE, "%.17g", value);
+        return buf + n;
+#endif
+    }
+} // namespace easy_json
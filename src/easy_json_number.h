@@ -0,0 +1,13 @@
+﻿#pragma once
+#include "easy_json_reader.h"
+
+namespace easy_json
+{
+    // Writes the shortest text that parses back to the same double, without
+    // touching the locale. Non finite values have no JSON form and become null.
+    // buf needs NUMBER_BUFFER_SIZE bytes, returns the end of the written text.
+    constexpr size_t NUMBER_BUFFER_SIZE = 32;
+    char * format_number(char * buf, double value);
+    char * format_number(char * buf, int64_t value);
+    char * format_number(char * buf, uint64_t value);
+} // namespace easy_json
@@ -0,0 +1,228 @@
+﻿#include "easy_json_path.h"
+
+namespace easy_json
+{
+    namespace
+    {
+        // array index tokens: 0 or digits without a leading zero
+        int64_t parse_index(std::string_view token)
+        {
+            if (token.empty() || token.size() > 18 || (token.size() > 1 && token[0] == '0'))
+                return -1;
+            int64_t index = 0;
+            for (char c : token)
+            {
+                if (c < '0' || c > '9')
+                    return -1;
+                index = index * 10 + (c - '0');
+            }
+            return index;
+        }
+
+        JsonAny * lookup(JsonAny * value, const std::string & key, uint32_t hash, int64_t index)
+        {
+            if (auto * object = value->to_object())
+                return object->get_property(key, hash);
+            auto * array = value->to_array();
+            if (array != nullptr && index >= 0 && static_cast<size_t>(index) < array->count())
+                return array->at(static_cast<int>(index));
+            return nullptr;
+        }
+
+        JsonLazyValue lookup(JsonLazyValue value, const std::string & key, uint32_t, int64_t index)
+        {
+            if (value.is_object())
+                return value.get_property(key);
+            if (value.is_array() && index >= 0 && index <= INT32_MAX)
+                return value.at(static_cast<int>(index));
+            return JsonLazyValue();
+        }
+
+        bool found(const JsonAny * value) { return value != nullptr; }
+        bool found(const JsonLazyValue & value) { return value.valid(); }
+    } // namespace
+
+    void JsonPath::add_step(std::string key, bool may_be_index)
+    {
+        Step step;
+        step.hash = JsonObject::hash_key(key);
+        step.index = may_be_index ? parse_index(key) : -1;
+        step.key = std::move(key);
+        _steps.push_back(std::move(step));
+    }
+
+    bool JsonPath::compile_pointer(std::string_view pointer)
+    {
+        _steps.clear();
+        if (pointer.empty())
+            return true;
+        if (pointer[0] != '/')
+            return false;
+
+        size_t p = 1;
+        while (true)
+        {
+            size_t end = pointer.find('/', p);
+            if (end == std::string_view::npos)
+                end = pointer.size();
+
+            std::string token;
+            for (size_t i = p; i < end; ++i)
+            {
+                if (pointer[i] != '~')
+                {
+                    token.push_back(pointer[i]);
+                    continue;
+                }
+                if (++i == end || (pointer[i] != '0' && pointer[i] != '1'))
+                {
+                    _steps.clear();
+                    return false;
+                }
+                token.push_back(pointer[i] == '0' ? '~' : '/');
+            }
+            add_step(std::move(token), true);
+
+            if (end == pointer.size())
+                return true;
+            p = end + 1;
+        }
+    }
+
+    bool JsonPath::compile(std::string_view path)
+    {
+        _steps.clear();
+        if (path.empty() || path[0] != '$')
+            return false;
+
+        size_t p = 1;
+        while (p < path.size())
+        {
+            if (path[p] == '.')
+            {
+                size_t begin = ++p;
+                while (p < path.size() && path[p] != '.' && path[p] != '[')
+                    ++p;
+                if (p == begin)
+                {
+                    _steps.clear();
+                    return false;
+                }
+                add_step(std::string(path.substr(begin, p - begin)), false);
+            }
+            else if (path[p] == '[' && p + 1 < path.size() && (path[p + 1] == '\'' || path[p + 1] == '\"'))
+            {
+                // quoted member name, backslash escapes the next character
+                char quote = path[p + 1];
+                std::string key;
+                p += 2;
+                while (p < path.size() && path[p] != quote)
+                {
+                    if (path[p] == '\\' && p + 1 < path.size())
+                        ++p;
+                    key.push_back(path[p++]);
+                }
+                if (p + 1 >= path.size() || path[p + 1] != ']')
+                {
+                    _steps.clear();
+                    return false;
+                }
+                p += 2;
+                add_step(std::move(key), false);
+            }
+            else if (path[p] == '[')
+            {
+                size_t end = path.find(']', p);
+                if (end == std::string_view::npos || parse_index(path.substr(p + 1, end - p - 1)) < 0)
+                {
+                    _steps.clear();
+                    return false;
+                }
+                add_step(std::string(path.substr(p + 1, end - p - 1)), true);
+                p = end + 1;
+            }
+            else
+            {
+                _steps.clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    JsonAny * JsonPath::find(const JsonAny * root) const
+    {
+        auto * value = const_cast<JsonAny *>(root);
+        for (size_t i = 0; value != nullptr && i < _steps.size(); ++i)
+            value = lookup(value, _steps[i].key, _steps[i].hash, _steps[i].index);
+        return value;
+    }
+
+    JsonLazyValue JsonPath::find(JsonLazyValue root) const
+    {
+        for (size_t i = 0; root.valid() && i < _steps.size(); ++i)
+            root = lookup(root, _steps[i].key, _steps[i].hash, _steps[i].index);
+        return root;
+    }
+
+    JsonPathSet::JsonPathSet()
+    {
+        _nodes.emplace_back();
+    }
+
+    size_t JsonPathSet::add(const JsonPath & path)
+    {
+        uint32_t node = 0;
+        for (const auto & step : path._steps)
+        {
+            uint32_t next = 0;
+            for (uint32_t child : _nodes[node].children)
+            {
+                if (_nodes[child].step.key == step.key && _nodes[child].step.index == step.index)
+                {
+                    next = child;
+                    break;
+                }
+            }
+            if (next == 0)
+            {
+                next = static_cast<uint32_t>(_nodes.size());
+                _nodes.emplace_back();
+                _nodes.back().step = step;
+                _nodes[node].children.push_back(next);
+            }
+            node = next;
+        }
+        _nodes[node].paths.push_back(static_cast<uint32_t>(_count));
+        return _count++;
+    }
+
+    template <typename Value>
+    void JsonPathSet::walk(uint32_t node, Value value, std::vector<Value> & results) const
+    {
+        const Node & n = _nodes[node];
+        for (uint32_t id : n.paths)
+            results[id] = value;
+        for (uint32_t child : n.children)
+        {
+            const JsonPath::Step & step = _nodes[child].step;
+            Value next = lookup(value, step.key, step.hash, step.index);
+            if (found(next))
+                walk(child, next, results);
+        }
+    }
+
+    void JsonPathSet::find(const JsonAny * root, std::vector<JsonAny *> & results) const
+    {
+        results.assign(_count, nullptr);
+        if (root != nullptr)
+            walk<JsonAny *>(0, const_cast<JsonAny *>(root), results);
+    }
+
+    void JsonPathSet::find(JsonLazyValue root, std::vector<JsonLazyValue> & results) const
+    {
+        results.assign(_count, JsonLazyValue());
+        if (root.valid())
+            walk<JsonLazyValue>(0, root, results);
+    }
+} // namespace easy_json
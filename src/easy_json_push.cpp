@@ -0,0 +1,45 @@
+﻿#include "easy_json_push.h"
+#include "easy_json_dom.h"
+
+namespace easy_json
+{
+    JsonPushParser::JsonPushParser(JsonDocument & document, uint32_t flags)
+        : _document(document)
+    {
+        // chunks do not outlive feed(), nothing can be borrowed from them
+        _flags = flags & ~static_cast<uint32_t>(JSON_PARSE_BORROW_INPUT);
+        reset();
+    }
+
+    JsonPushParser::~JsonPushParser() = default;
+
+    void JsonPushParser::reset()
+    {
+        _document.reset();
+        _builder.reset(new JsonDomBuilder(&_document, _flags));
+        _reader.reset(new JsonPushReader<JsonDomBuilder>(*_builder));
+        _reader->set_limits(_document.limits());
+    }
+
+    bool JsonPushParser::feed(const char * data, size_t size)
+    {
+        return _reader->feed(data, size);
+    }
+
+    JsonAny * JsonPushParser::finish()
+    {
+        if (!_reader->finish())
+        {
+            _document.reset();
+            return nullptr;
+        }
+        _document.set_root(_builder->result());
+        return _document.root();
+    }
+
+    int JsonPushParser::error() const { return _reader->error(); }
+    const char * JsonPushParser::error_message() const { return _reader->error_message(); }
+    size_t JsonPushParser::error_offset() const { return _reader->error_offset(); }
+    size_t JsonPushParser::error_line() const { return _reader->error_line(); }
+    size_t JsonPushParser::error_column() const { return _reader->error_column(); }
+} // namespace easy_json
@@ -0,0 +1,138 @@
+﻿#include "easy_json_reader.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EASY_JSON_SCAN_SSE2 1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#define EASY_JSON_SCAN_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+namespace easy_json
+{
+    namespace
+    {
+        inline bool is_special(char c) { return c == '"' || c == '\\'; }
+
+        const char * scan_scalar(const char * p, const char * end)
+        {
+            while (p < end && !is_special(*p))
+                ++p;
+            return p;
+        }
+
+        // SWAR: eight bytes per step, a zero byte in (x ^ pattern) marks a match
+        const char * scan_swar(const char * p, const char * end)
+        {
+            constexpr uint64_t ones = 0x0101010101010101ull;
+            constexpr uint64_t highs = 0x8080808080808080ull;
+            constexpr uint64_t quotes = ones * '"';
+            constexpr uint64_t slashes = ones * '\\';
+
+            while (end - p >= 8)
+            {
+                uint64_t x;
+                memcpy(&x, p, 8);
+                uint64_t q = x ^ quotes;
+                uint64_t s = x ^ slashes;
+                uint64_t hit = ((q - ones) & ~q & highs) | ((s - ones) & ~s & highs);
+                if (hit != 0)
+                    return scan_scalar(p, p + 8);
+                p += 8;
+            }
+            return scan_scalar(p, end);
+        }
+
+#ifdef EASY_JSON_SCAN_SSE2
+        inline int first_bit(uint32_t mask)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_ctz(mask);
+#else
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return static_cast<int>(index);
+#endif
+        }
+
+        const char * scan_sse2(const char * p, const char * end)
+        {
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i slash = _mm_set1_epi8('\\');
+            while (end - p >= 16)
+            {
+                __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, slash));
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hit));
+                if (mask != 0)
+                    return p + first_bit(mask);
+                p += 16;
+            }
+            return scan_swar(p, end);
+        }
+#endif
+
+#ifdef EASY_JSON_SCAN_AVX2
+        __attribute__((target("avx2")))
+        const char * scan_avx2(const char * p, const char * end)
+        {
+            const __m256i quote = _mm256_set1_epi8('"');
+            const __m256i slash = _mm256_set1_epi8('\\');
+            while (end - p >= 32)
+            {
+                __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, slash));
+                uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+                if (mask != 0)
+                    return p + first_bit(mask);
+                p += 32;
+            }
+            return scan_sse2(p, end);
+        }
+#endif
+
+        typedef const char * (*ScanFunc)(const char *, const char *);
+
+        struct ScanImpl
+        {
+            ScanFunc func;
+            const char * name;
+        };
+
+        ScanImpl select_scan()
+        {
+#ifdef EASY_JSON_SCAN_AVX2
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return { scan_avx2, "avx2" };
+#endif
+#ifdef EASY_JSON_SCAN_SSE2
+            return { scan_sse2, "sse2" };
+#else
+            return { scan_swar, "swar" };
+#endif
+        }
+
+        const ScanImpl scan_impl = select_scan();
+    } // namespace
+
+    const char * scan_string(const char * p, const char * end)
+    {
+        // short runs are common for keys, skip the dispatch for them
+        if (end - p < 16)
+            return scan_scalar(p, end);
+        return scan_impl.func(p, end);
+    }
+
+    const char * scan_string_impl()
+    {
+        return scan_impl.name;
+    }
+} // namespace easy_json
@@ -0,0 +1,391 @@
+﻿#include "easy_json_transcode.h"
+#include "easy_json_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace easy_json
+{
+    // Forwards reader events to the writer. With sort_keys every object is
+    // recorded on a tape until the outermost one closes, then written back
+    // with the members of each object in key order.
+    class JsonTranscodeHandler : public JsonBaseHandler
+    {
+    private:
+        enum : char
+        {
+            TAPE_OBJECT,    // followed by the tape offset of its end
+            TAPE_ARRAY,
+            TAPE_KEY,       // followed by the length and the text
+            TAPE_STRING,
+            TAPE_NUMBER,
+            TAPE_TRUE,
+            TAPE_FALSE,
+            TAPE_NULL,
+        };
+
+        struct Member
+        {
+            std::string_view key;
+            size_t value;    // tape offset
+        };
+
+        struct Frame
+        {
+            bool is_object;
+            size_t next;     // member index, or tape offset of the next element
+            size_t end;      // past the last member index, or tape end of the array
+            size_t first;    // members of the object start here
+        };
+
+        JsonWriter & writer;
+        bool sort_keys = false;
+        size_t sort_buffer = 0;
+        std::string tape;
+        std::vector<size_t> open;       // end slots of the containers open on the tape
+        std::vector<Member> members;    // of the objects being written back
+        std::vector<Frame> frames;      // containers being written back
+        const char * error = nullptr;
+
+        bool recording() const { return !open.empty(); }
+
+        bool fits()
+        {
+            if (tape.size() <= sort_buffer)
+                return true;
+            error = "object larger than the sort buffer";
+            return false;
+        }
+
+        bool record(char tag)
+        {
+            tape.push_back(tag);
+            return fits();
+        }
+
+        bool record(char tag, std::string_view text)
+        {
+            uint32_t length = static_cast<uint32_t>(text.size());
+            tape.push_back(tag);
+            tape.append(reinterpret_cast<const char *>(&length), sizeof(length));
+            tape.append(text.data(), text.size());
+            return fits();
+        }
+
+        bool record_open(char tag)
+        {
+            uint32_t end = 0;
+            tape.push_back(tag);
+            open.push_back(tape.size());
+            tape.append(reinterpret_cast<const char *>(&end), sizeof(end));
+            return fits();
+        }
+
+        // the outermost container closing writes the whole tape back
+        void record_close()
+        {
+            uint32_t end = static_cast<uint32_t>(tape.size());
+            memcpy(&tape[open.back()], &end, sizeof(end));
+            open.pop_back();
+            if (!open.empty())
+                return;
+            replay();
+            tape.clear();
+        }
+
+        uint32_t read_length(size_t pos) const
+        {
+            uint32_t length;
+            memcpy(&length, tape.data() + pos, sizeof(length));
+            return length;
+        }
+
+        std::string_view read_text(size_t pos) const
+        {
+            return std::string_view(tape.data() + pos + 1 + sizeof(uint32_t), read_length(pos + 1));
+        }
+
+        size_t skip(size_t pos) const
+        {
+            switch (tape[pos])
+            {
+            case TAPE_OBJECT:
+            case TAPE_ARRAY:
+                return read_length(pos + 1);
+            case TAPE_KEY:
+            case TAPE_STRING:
+            case TAPE_NUMBER:
+                return pos + 1 + sizeof(uint32_t) + read_length(pos + 1);
+            default:
+                return pos + 1;
+            }
+        }
+
+        // Writes the tape back. Iterative: every open container is a frame,
+        // an object walking its sorted members and an array its tape span.
+        void replay()
+        {
+            size_t pos = 0;
+            while (true)
+            {
+                switch (tape[pos])
+                {
+                case TAPE_OBJECT:
+                {
+                    size_t end = read_length(pos + 1);
+                    size_t first = members.size();
+                    for (pos += 1 + sizeof(uint32_t); pos < end;)
+                    {
+                        std::string_view key = read_text(pos);
+                        pos = skip(pos);
+                        members.push_back(Member{ key, pos });
+                        pos = skip(pos);
+                    }
+                    // stable, so duplicate keys keep their order
+                    std::stable_sort(members.begin() + first, members.end(),
+                                     [](const Member & a, const Member & b) { return a.key < b.key; });
+                    writer.begin_object();
+                    frames.push_back(Frame{ true, first, members.size(), first });
+                    break;
+                }
+                case TAPE_ARRAY:
+                    writer.begin_array();
+                    frames.push_back(Frame{ false, pos + 1 + sizeof(uint32_t), read_length(pos + 1), 0 });
+                    break;
+                case TAPE_STRING:
+                    writer.string(read_text(pos));
+                    break;
+                case TAPE_NUMBER:
+                    writer.raw_number(read_text(pos));
+                    break;
+                case TAPE_TRUE:
+                    writer.boolean(true);
+                    break;
+                case TAPE_FALSE:
+                    writer.boolean(false);
+                    break;
+                default:
+                    writer.null();
+                    break;
+                }
+
+                // the next value, closing the containers that are done
+                while (true)
+                {
+                    if (frames.empty())
+                        return;
+                    Frame & top = frames.back();
+                    if (top.next < top.end)
+                    {
+                        if (top.is_object)
+                        {
+                            writer.key(members[top.next].key);
+                            pos = members[top.next++].value;
+                        }
+                        else
+                        {
+                            pos = top.next;
+                            top.next = skip(pos);
+                        }
+                        break;
+                    }
+                    if (top.is_object)
+                    {
+                        writer.end_object();
+                        members.resize(top.first);
+                    }
+                    else
+                    {
+                        writer.end_array();
+                    }
+                    frames.pop_back();
+                }
+            }
+        }
+
+    public:
+        JsonTranscodeHandler(JsonWriter & output, const JsonTranscodeOptions & options)
+            : writer(output), sort_keys(options.sort_keys)
+        {
+            // tape offsets are 32 bit
+            sort_buffer = std::min<size_t>(options.sort_buffer, UINT32_MAX);
+        }
+
+        const char * error_message() const { return error; }
+
+        // the tape keeps its capacity for the next document
+        void reset()
+        {
+            tape.clear();
+            open.clear();
+            members.clear();
+            frames.clear();
+            error = nullptr;
+        }
+
+        bool on_null()
+        {
+            if (recording())
+                return record(TAPE_NULL);
+            writer.null();
+            return true;
+        }
+
+        bool on_boolean(bool v)
+        {
+            if (recording())
+                return record(v ? TAPE_TRUE : TAPE_FALSE);
+            writer.boolean(v);
+            return true;
+        }
+
+        bool on_number(const JsonNumberValue &, std::string_view text)
+        {
+            if (recording())
+                return record(TAPE_NUMBER, text);
+            writer.raw_number(text);
+            return true;
+        }
+
+        bool on_string(std::string_view value, bool)
+        {
+            if (recording())
+                return record(TAPE_STRING, value);
+            writer.string(value);
+            return true;
+        }
+
+        bool on_key(std::string_view name, bool)
+        {
+            if (recording())
+                return record(TAPE_KEY, name);
+            writer.key(name);
+            return true;
+        }
+
+        bool on_start_object()
+        {
+            if (sort_keys)
+                return record_open(TAPE_OBJECT);
+            writer.begin_object();
+            return true;
+        }
+
+        bool on_end_object(size_t)
+        {
+            if (recording())
+                record_close();
+            else
+                writer.end_object();
+            return true;
+        }
+
+        bool on_start_array()
+        {
+            if (recording())
+                return record_open(TAPE_ARRAY);
+            writer.begin_array();
+            return true;
+        }
+
+        bool on_end_array(size_t)
+        {
+            if (recording())
+                record_close();
+            else
+                writer.end_array();
+            return true;
+        }
+    };
+
+    JsonTranscoder::JsonTranscoder(JsonSink & sink, const JsonTranscodeOptions & options)
+    {
+        _writer.reset(new JsonWriter(sink));
+        _writer->set_indent(options.indent);
+        _writer->set_escape_unicode(options.escape_unicode);
+        _handler.reset(new JsonTranscodeHandler(*_writer, options));
+        _reader.reset(new JsonPushReader<JsonTranscodeHandler>(*_handler));
+        _reader->set_limits(options.limits);
+        _limits = options.limits;
+    }
+
+    JsonTranscoder::~JsonTranscoder() = default;
+
+    bool JsonTranscoder::fail(const char * message, size_t offset)
+    {
+        // the handler knows why it stopped the reader
+        _error = _handler->error_message() ? _handler->error_message() : message;
+        _error_offset = offset;
+        _writer->reset();
+        _handler->reset();
+        _reader->reset();
+        return false;
+    }
+
+    bool JsonTranscoder::transcode(const char * data, size_t size)
+    {
+        reset();
+        JsonReader<JsonTranscodeHandler> reader(data, size);
+        reader.set_limits(_limits);
+        if (!reader.parse(*_handler))
+            return fail(json_error_message(reader.error()), reader.offset());
+        if (!_writer->flush())
+            return fail("write to the sink failed", size);
+        return true;
+    }
+
+    bool JsonTranscoder::transcode(FILE * file)
+    {
+        reset();
+        std::vector<char> chunk(64 * 1024);
+        while (size_t n = fread(chunk.data(), 1, chunk.size(), file))
+        {
+            if (!feed(chunk.data(), n))
+                return false;
+        }
+        if (ferror(file))
+            return fail(json_error_message(JSON_ERROR_FILE), 0);
+        return finish();
+    }
+
+    bool JsonTranscoder::transcode_file(const char * path)
+    {
+        JsonMappedFile file;
+        if (!file.open(path))
+            return fail(json_error_message(JSON_ERROR_FILE), 0);
+        return transcode(file.data(), file.size());
+    }
+
+    bool JsonTranscoder::feed(const char * data, size_t size)
+    {
+        if (!_reader->feed(data, size))
+            return fail(_reader->error_message(), _reader->error_offset());
+        return true;
+    }
+
+    bool JsonTranscoder::finish()
+    {
+        if (!_reader->finish())
+            return fail(_reader->error_message(), _reader->error_offset());
+        _reader->reset();
+        if (!_writer->flush())
+            return fail("write to the sink failed", 0);
+        return true;
+    }
+
+    void JsonTranscoder::reset()
+    {
+        _writer->reset();
+        _handler->reset();
+        _reader->reset();
+        _error = nullptr;
+        _error_offset = 0;
+    }
+
+    const char * JsonTranscoder::error_message() const
+    {
+        return _error;
+    }
+} // namespace easy_json
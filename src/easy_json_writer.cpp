@@ -0,0 +1,427 @@
+﻿#include "easy_json_writer.h"
+#include "easy_json_number.h"
+
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace easy_json
+{
+    namespace
+    {
+        // 0: copy as is, otherwise the character after the backslash ('u' for \u00XX)
+        const char * const escape_table = []() {
+            static char table[256] = { 0 };
+            for (int c = 0; c < 0x20; ++c)
+                table[c] = 'u';
+            table[static_cast<unsigned char>('"')] = '"';
+            table[static_cast<unsigned char>('\\')] = '\\';
+            table[static_cast<unsigned char>('\b')] = 'b';
+            table[static_cast<unsigned char>('\f')] = 'f';
+            table[static_cast<unsigned char>('\n')] = 'n';
+            table[static_cast<unsigned char>('\r')] = 'r';
+            table[static_cast<unsigned char>('\t')] = 't';
+            return table;
+        }();
+
+        // the same with every byte of a multi-byte UTF-8 sequence marked 'U'
+        const char * const ascii_escape_table = []() {
+            static char table[256] = { 0 };
+            memcpy(table, escape_table, sizeof(table));
+            for (int c = 0x80; c < 0x100; ++c)
+                table[c] = 'U';
+            return table;
+        }();
+
+        const char hex_digits[] = "0123456789abcdef";
+
+        void put_hex4(char * out, uint32_t value)
+        {
+            out[0] = '\\';
+            out[1] = 'u';
+            for (int i = 0; i < 4; ++i)
+                out[2 + i] = hex_digits[(value >> (12 - 4 * i)) & 0xF];
+        }
+    } // namespace
+
+    bool JsonFileSink::write(const char * data, size_t size)
+    {
+        return _file != nullptr && fwrite(data, 1, size, _file) == size;
+    }
+
+    bool JsonFdSink::write(const char * data, size_t size)
+    {
+        while (size > 0)
+        {
+#if defined(_WIN32)
+            int n = ::_write(_fd, data, static_cast<unsigned int>(size));
+#else
+            ssize_t n = ::write(_fd, data, size);
+#endif
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    JsonWriter::JsonWriter(std::string & out, size_t reserve)
+    {
+        _target = &out;
+        _total = out.size();
+        out.resize(_total + std::max<size_t>(reserve, 64));
+        _buf = &out[_total];
+        _cap = out.size() - _total;
+    }
+
+    JsonWriter::JsonWriter(JsonSink & sink, size_t buffer_size)
+    {
+        _sink = &sink;
+        _storage.resize(std::max<size_t>(buffer_size, 64));
+        _buf = _storage.data();
+        _cap = _storage.size();
+    }
+
+    JsonWriter::~JsonWriter()
+    {
+        flush();
+    }
+
+    void JsonWriter::make_room(size_t size)
+    {
+        if (_target)
+        {
+            // grow the target string in place, it is trimmed again by flush()
+            size_t used = _total + _len;
+            _target->resize(std::max(used + size, _target->size() * 2));
+            _buf = &(*_target)[_total];
+            _cap = _target->size() - _total;
+            return;
+        }
+
+        flush();
+        if (_cap < size)
+        {
+            _storage.resize(size);
+            _buf = _storage.data();
+            _cap = _storage.size();
+        }
+    }
+
+    bool JsonWriter::flush()
+    {
+        if (_target)
+        {
+            _target->resize(_total + _len);
+            _buf = &(*_target)[_total];
+            _cap = _len;
+            return _ok;
+        }
+
+        if (_len > 0)
+        {
+            _ok = _sink->write(_buf, _len) && _ok;
+            _total += _len;
+            _len = 0;
+        }
+        return _ok;
+    }
+
+    void JsonWriter::reset()
+    {
+        _len = 0;
+        _ok = true;
+        _has_value.clear();
+        _after_key = false;
+    }
+
+    void JsonWriter::separator()
+    {
+        EASY_JSON_STAT(++_stats.values);
+        if (_after_key)
+        {
+            _after_key = false;
+            return;
+        }
+        if (!_has_value.empty())
+        {
+            if (_has_value.back())
+                put(',');
+            _has_value.back() = 1;
+            new_line();
+        }
+    }
+
+    void JsonWriter::new_line()
+    {
+        if (_indent == 0)
+            return;
+        put('\n');
+        size_t spaces = _has_value.size() * static_cast<size_t>(_indent);
+        if (_cap - _len < spaces)
+            make_room(spaces);
+        memset(_buf + _len, ' ', spaces);
+        _len += spaces;
+    }
+
+    // non-empty containers close on a line of their own when indenting
+    void JsonWriter::close_container(char c)
+    {
+        bool has_value = !_has_value.empty() && _has_value.back();
+        if (!_has_value.empty())
+            _has_value.pop_back();
+        if (has_value)
+            new_line();
+        put(c);
+    }
+
+    // one UTF-8 sequence at p as \u escapes, returns the byte after it
+    const char * JsonWriter::write_unicode_escape(const char * p, const char * end)
+    {
+        auto byte = [](const char * q) { return static_cast<unsigned char>(*q); };
+        unsigned char lead = byte(p);
+        size_t length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+        uint32_t cp = length == 4 ? lead & 0x07 : length == 3 ? lead & 0x0F : lead & 0x1F;
+        bool valid = length > 1 && lead < 0xF5 && static_cast<size_t>(end - p) >= length;
+        for (size_t i = 1; valid && i < length; ++i)
+        {
+            valid = (byte(p + i) & 0xC0) == 0x80;
+            cp = (cp << 6) | (byte(p + i) & 0x3F);
+        }
+        // overlong forms, surrogates and values past U+10FFFF are malformed
+        static const uint32_t min_cp[] = { 0, 0, 0x80, 0x800, 0x10000 };
+        if (!valid || cp < min_cp[length] || (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF)
+        {
+            cp = 0xFFFD;
+            length = 1;
+        }
+
+        char tmp[12];
+        if (cp >= 0x10000)
+        {
+            put_hex4(tmp, 0xD800 + ((cp - 0x10000) >> 10));
+            put_hex4(tmp + 6, 0xDC00 + ((cp - 0x10000) & 0x3FF));
+            put(tmp, 12);
+        }
+        else
+        {
+            put_hex4(tmp, cp);
+            put(tmp, 6);
+        }
+        return p + length;
+    }
+
+    void JsonWriter::write_escaped(std::string_view value)
+    {
+        const char * table = _escape_unicode ? ascii_escape_table : escape_table;
+
+        put('"');
+        const char * p = value.data();
+        const char * end = p + value.size();
+        while (p < end)
+        {
+            // copy the clean run in one go
+            const char * run = p;
+            while (p < end && table[static_cast<unsigned char>(*p)] == 0)
+                ++p;
+            if (p > run)
+                put(run, p - run);
+            if (p == end)
+                break;
+
+            char e = table[static_cast<unsigned char>(*p)];
+            EASY_JSON_STAT(++_stats.escapes);
+            if (e == 'U')
+            {
+                p = write_unicode_escape(p, end);
+                continue;
+            }
+            if (e == 'u')
+            {
+                char tmp[6];
+                put_hex4(tmp, static_cast<unsigned char>(*p));
+                put(tmp, sizeof(tmp));
+            }
+            else
+            {
+                char tmp[2] = { '\\', e };
+                put(tmp, sizeof(tmp));
+            }
+            ++p;
+        }
+        put('"');
+    }
+
+    void JsonWriter::begin_object()
+    {
+        separator();
+        put('{');
+        _has_value.push_back(0);
+    }
+
+    void JsonWriter::end_object()
+    {
+        close_container('}');
+    }
+
+    void JsonWriter::begin_array()
+    {
+        separator();
+        put('[');
+        _has_value.push_back(0);
+    }
+
+    void JsonWriter::end_array()
+    {
+        close_container(']');
+    }
+
+    void JsonWriter::key(std::string_view name)
+    {
+        separator();
+        EASY_JSON_STAT(--_stats.values);
+        write_escaped(name);
+        if (_indent)
+            put(": ", 2);
+        else
+            put(':');
+        _after_key = true;
+    }
+
+    void JsonWriter::string(std::string_view value)
+    {
+        separator();
+        write_escaped(value);
+    }
+
+    void JsonWriter::integer(int64_t value)
+    {
+        separator();
+        char tmp[NUMBER_BUFFER_SIZE];
+        put(tmp, format_number(tmp, value) - tmp);
+    }
+
+    void JsonWriter::unsigned_integer(uint64_t value)
+    {
+        separator();
+        char tmp[NUMBER_BUFFER_SIZE];
+        put(tmp, format_number(tmp, value) - tmp);
+    }
+
+    void JsonWriter::number(double value)
+    {
+        separator();
+        char tmp[NUMBER_BUFFER_SIZE];
+        put(tmp, format_number(tmp, value) - tmp);
+    }
+
+    void JsonWriter::raw_number(std::string_view text)
+    {
+        separator();
+        put(text.data(), text.size());
+    }
+
+    void JsonWriter::boolean(bool value)
+    {
+        separator();
+        if (value)
+            put("true", 4);
+        else
+            put("false", 5);
+    }
+
+    void JsonWriter::null()
+    {
+        separator();
+        put("null", 4);
+    }
+
+    bool JsonWriter::write(const JsonAny * value)
+    {
+        if (value == nullptr)
+            return false;
+        write_value(value);
+        return _ok;
+    }
+
+    void JsonWriter::write_value(const JsonAny * value)
+    {
+        switch (value->type())
+        {
+        case JsonType::Null:
+            null();
+            break;
+        case JsonType::Boolean:
+            boolean(value->to_boolean());
+            break;
+        case JsonType::Number:
+            switch (value->number_type())
+            {
+            case JsonNumberType::Int64:
+                integer(value->to_integer());
+                break;
+            case JsonNumberType::Uint64:
+                unsigned_integer(value->to_unsigned());
+                break;
+            case JsonNumberType::Raw:
+                raw_number(value->number_text());
+                break;
+            default:
+                number(value->to_number());
+                break;
+            }
+            break;
+        case JsonType::String:
+            string(value->str_view());
+            break;
+        case JsonType::Object:
+        {
+            const JsonObject * obj = value->to_object();
+            begin_object();
+            for (int i = 0, n = static_cast<int>(obj->count()); i < n; ++i)
+            {
+                key(obj->key_view_at(i));
+                write_value(obj->value_at(i));
+            }
+            end_object();
+            break;
+        }
+        case JsonType::Array:
+        {
+            const JsonArray * arr = value->to_array();
+            begin_array();
+            // packed columns are written without making element nodes
+            JsonColumn column = arr->column();
+            if (const double * doubles = column.doubles())
+            {
+                for (size_t i = 0; i < column.size; ++i)
+                    number(doubles[i]);
+                end_array();
+                break;
+            }
+            if (const int64_t * integers = column.integers())
+            {
+                for (size_t i = 0; i < column.size; ++i)
+                    integer(integers[i]);
+                end_array();
+                break;
+            }
+            for (int i = 0, n = static_cast<int>(arr->count()); i < n; ++i)
+            {
+                const JsonAny * item = arr->at(i);
+                if (item)
+                    write_value(item);
+                else
+                    null();
+            }
+            end_array();
+            break;
+        }
+        }
+    }
+} // namespace easy_json
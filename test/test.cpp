@@ -1,5 +1,1057 @@
 ﻿#include "easy_json.h"
+#include "easy_json_bind.h"
+#include "easy_json_lazy.h"
+#include "easy_json_lines.h"
+#include "easy_json_msgpack.h"
+#include "easy_json_path.h"
+#include "easy_json_push.h"
+#include "easy_json_reader.h"
+#include "easy_json_shared.h"
+#include "easy_json_stats.h"
+#include "easy_json_transcode.h"
+#include "easy_json_writer.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(expr) \
+    do { if (!(expr)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); ++failures; } } while (0)
+
+static void test_document()
+{
+    const char json_string[] = R"({"a":[1,2,{"b":"x"}],"c":null})";
+
+    easy_json::JsonDocument doc;
+    CHECK(doc.parse(json_string));
+    CHECK(doc.root() != nullptr && doc.root()->is_object());
+    CHECK(doc.arena().bytes_used() > 0);
+
+    auto * a = doc.root()->to_object()->get_property("a");
+    CHECK(a != nullptr && a->is_array() && a->to_array()->count() == 3);
+    CHECK(a->to_array()->at(2)->to_object()->get_property("b")->to_str() == "x");
+
+    // heap nodes attached to a document are released together with it,
+    // replaced or attached twice
+    auto * heap = easy_json::JsonAny::str("heap");
+    doc.root()->to_object()->set_property("d", heap);
+    doc.root()->to_object()->set_property("d", doc.integer(1));
+    a->to_array()->add(heap)->add(heap);
+    easy_json::JsonAny::destroy(heap);
+    CHECK(a->to_array()->at(4)->to_str() == "heap");
+    doc.set_root(heap);
+    doc.clear();
+    CHECK(doc.root() == nullptr && doc.arena().bytes_used() == 0);
+
+    // a frozen document takes the node it ignores
+    CHECK(doc.parse(json_string));
+    doc.freeze();
+    doc.root()->to_object()->set_property("e", easy_json::JsonAny::str("dropped"));
+    doc.root()->to_object()->get_property("a")->to_array()->add(easy_json::JsonAny::array());
+    doc.set_root(easy_json::JsonAny::null());
+    CHECK(doc.root()->to_object()->count() == 2 && doc.root()->to_object()->get_property("e") == nullptr);
+
+    easy_json::JsonDocument pooled(easy_json::JsonArena::thread_local_pool());
+    CHECK(pooled.parse("[true,false]"));
+    CHECK(pooled.root()->to_array()->at(0)->to_boolean());
+}
+
+static void test_value()
+{
+    static_assert(sizeof(easy_json::JsonAny) == 16, "tagged value size");
+
+    auto * obj = easy_json::JsonAny::object();
+    obj->set_property("s", easy_json::JsonAny::str("abc"))
+        ->set_property("n", easy_json::JsonAny::number(1.5))
+        ->set_property("s", easy_json::JsonAny::boolean(true));
+    CHECK(obj->count() == 2);
+    CHECK(obj->get_property("s")->is_boolean() && obj->get_property("s")->to_boolean());
+    CHECK(obj->get_property("n")->to_number() == 1.5);
+    CHECK(obj->get_property("n")->to_object() == nullptr);
+    CHECK(obj->get_property("n")->to_str().empty());
+    easy_json::JsonAny::destroy(obj);
+}
+
+static void test_object_index()
+{
+    std::string text = "{";
+    for (int i = 0; i < 1000; ++i)
+        text += (i ? ",\"k" : "\"k") + std::to_string(i) + "\":" + std::to_string(i);
+    text += ",\"k7\":-1}";
+
+    easy_json::JsonDocument doc;
+    CHECK(doc.parse(text.c_str()));
+    auto * obj = doc.root()->to_object();
+    CHECK(obj->count() == 1000);
+    CHECK(obj->get_property("k999")->to_integer() == 999);
+    CHECK(obj->get_property(std::string_view("k7"))->to_integer() == -1);
+    CHECK(obj->key_view_at(7) == "k7");
+
+    uint32_t hash = easy_json::JsonObject::hash_key("k500");
+    CHECK(obj->get_property("k500", hash)->to_integer() == 500);
+    CHECK(obj->get_property("missing") == nullptr);
+}
+
+static void test_strings()
+{
+    std::string blob(1000, 'x');
+    std::string text = "[\"" + blob + "\\n" + blob + "\", \"\\u00e9\\u4e2d\\ud83d\\ude00\\\"\"]";
+
+    auto * json = easy_json::JsonAny::parse(text.c_str());
+    CHECK(json != nullptr);
+    if (json == nullptr)
+        return;
+    CHECK(json->to_array()->at(0)->to_str() == blob + "\n" + blob);
+    CHECK(json->to_array()->at(1)->to_str() == "\xc3\xa9\xe4\xb8\xad\xf0\x9f\x98\x80\"");
+    delete json;
+
+    CHECK(easy_json::JsonAny::parse("[\"unterminated") == nullptr);
+}
+
+static void test_borrowed_strings()
+{
+    const std::string text = R"({"plain":"abc","esc\"key":"a\nb"})";
+
+    easy_json::JsonDocument doc;
+    CHECK(doc.parse(text.data(), text.size(), easy_json::JSON_PARSE_BORROW_INPUT));
+    auto * obj = doc.root()->to_object();
+    auto plain = obj->get_property("plain")->str_view();
+    CHECK(plain == "abc" && plain.data() > text.data() && plain.data() < text.data() + text.size());
+    CHECK(obj->key_view_at(0).data() == text.data() + 2);
+    CHECK(obj->get_property("esc\"key")->to_str() == "a\nb");
+
+    std::string buffer = text;
+    easy_json::JsonDocument in_situ;
+    CHECK(in_situ.parse_in_situ(&buffer[0], buffer.size()));
+    auto escaped = in_situ.root()->to_object()->get_property("esc\"key")->str_view();
+    CHECK(escaped == "a\nb" && escaped.data() > buffer.data() && escaped.data() < buffer.data() + buffer.size());
+}
+
+static void test_numbers()
+{
+    const char text[] = R"([1234567890123456789, -9223372036854775808, 18446744073709551615, 0.1, -2.5e-3, 1e400, 12345678901234567890123])";
+
+    easy_json::JsonDocument doc;
+    CHECK(doc.parse(text));
+    auto * arr = doc.root()->to_array();
+    CHECK(arr->at(0)->is_integer() && arr->at(0)->to_integer() == 1234567890123456789LL);
+    CHECK(arr->at(1)->to_integer() == INT64_MIN);
+    CHECK(arr->at(2)->number_type() == easy_json::JsonNumberType::Uint64 && arr->at(2)->to_unsigned() == UINT64_MAX);
+    CHECK(arr->at(3)->to_number() == 0.1);
+    CHECK(arr->at(4)->to_number() == -2.5e-3);
+    CHECK(arr->at(5)->to_number() > 1e308);
+    CHECK(!arr->at(6)->is_integer() && arr->at(6)->to_number() == 12345678901234567890123.0);
+
+    easy_json::JsonDocument raw;
+    CHECK(raw.parse(text, sizeof(text) - 1, easy_json::JSON_PARSE_RAW_NUMBERS));
+    CHECK(raw.root()->to_array()->at(6)->number_text() == "12345678901234567890123");
+    CHECK(raw.root()->to_array()->at(0)->to_integer() == 1234567890123456789LL);
+
+    // out of range by the digits alone, not only by the exponent
+    std::string big = "[" + std::string(400, '9') + ", " + std::string(400, '9') + ".5, -" + std::string(400, '9') + "e-10, 0." + std::string(400, '0') + "1e-10, 1e-400]";
+    CHECK(doc.parse(big));
+    arr = doc.root()->to_array();
+    CHECK(std::isinf(arr->at(0)->to_number()) && arr->at(0)->to_number() > 0);
+    CHECK(std::isinf(arr->at(1)->to_number()));
+    CHECK(std::isinf(arr->at(2)->to_number()) && arr->at(2)->to_number() < 0);
+    CHECK(arr->at(3)->to_number() == 0.0 && arr->at(4)->to_number() == 0.0);
+
+    CHECK(easy_json::JsonAny::parse("[01]") == nullptr);
+    CHECK(easy_json::JsonAny::parse("[1.]") == nullptr);
+    CHECK(easy_json::JsonAny::parse("[-]") == nullptr);
+}
+
+static void test_writer()
+{
+    const char text[] = R"({"a":[1,-2,true,null],"b\"":"x\ny\u0001","c":{},"d":[]})";
+
+    easy_json::JsonDocument doc;
+    CHECK(doc.parse(text));
+    CHECK(doc.root()->dump() == text);
+
+    std::string out = "prefix:";
+    {
+        easy_json::JsonWriter writer(out);
+        writer.begin_object();
+        writer.key("k");
+        writer.begin_array();
+        writer.integer(1);
+        writer.string("v");
+        writer.end_array();
+        writer.key("n");
+        writer.null();
+        writer.end_object();
+    }
+    CHECK(out == R"(prefix:{"k":[1,"v"],"n":null})");
+
+    auto * numbers = easy_json::JsonAny::array();
+    numbers->add(easy_json::JsonAny::number(1.0))
+        ->add(easy_json::JsonAny::number(0.1))
+        ->add(easy_json::JsonAny::number(1e-7))
+        ->add(easy_json::JsonAny::number(-1.5e300))
+        ->add(easy_json::JsonAny::number(5e-324));
+    CHECK(numbers->dump() == "[1,0.1,1e-07,-1.5e+300,5e-324]");
+    auto * reparsed = easy_json::JsonAny::parse(numbers->dump().c_str());
+    CHECK(reparsed && reparsed->to_array()->at(4)->to_number() == 5e-324);
+    delete reparsed;
+    easy_json::JsonAny::destroy(numbers);
+
+    std::string sunk;
+    easy_json::JsonStringSink sink(sunk);
+    CHECK(doc.root()->dump(sink) && sunk == text);
+}
+
+struct CountingHandler : easy_json::JsonBaseHandler
+{
+    int strings = 0;
+    int numbers = 0;
+    int objects = 0;
+    std::string keys;
+
+    bool on_string(std::string_view, bool) { ++strings; return true; }
+    bool on_number(const easy_json::JsonNumberValue &, std::string_view) { ++numbers; return true; }
+    bool on_start_object() { ++objects; return true; }
+    bool on_key(std::string_view key, bool) { keys.append(key); return true; }
+};
+
+static void test_sax()
+{
+    const char text[] = R"({"str":"1234", "num" : 4321,"obj":{"obj_str":"1234"},"arr":[1,2,3,4]})";
+
+    CountingHandler handler;
+    easy_json::JsonReader<CountingHandler> reader(text, sizeof(text) - 1);
+    CHECK(reader.parse(handler));
+    CHECK(handler.strings == 2 && handler.numbers == 5 && handler.objects == 2);
+    CHECK(handler.keys == "strnumobjobj_strarr");
+
+    easy_json::JsonReader<CountingHandler> bad("[1,", 3);
+    CHECK(!bad.parse(handler) && bad.error() != 0);
+}
+
+static void test_push_parser()
+{
+    const std::string text = "\xEF\xBB\xBF{\"id\": 18446744073709551615, \"s\": \"a\\u00e9\\ud83d\\ude00\\n\", "
+                             "\"arr\": [true, false, null, -1.25e2, {}], \"o\": {\"k\": []}}";
+
+    auto * expected = easy_json::JsonAny::parse(text.c_str());
+    CHECK(expected != nullptr);
+
+    // every split point, then one byte at a time
+    for (size_t step = 1; step <= text.size(); step = step < 3 ? step + 1 : step * 2)
+    {
+        easy_json::JsonDocument doc;
+        easy_json::JsonPushParser parser(doc);
+        for (size_t i = 0; i < text.size(); i += step)
+            CHECK(parser.feed(text.data() + i, std::min(step, text.size() - i)));
+        auto * root = parser.finish();
+        CHECK(root != nullptr && expected && root->dump() == expected->dump());
+    }
+    delete expected;
+
+    easy_json::JsonDocument doc;
+    easy_json::JsonPushParser parser(doc);
+    CHECK(parser.feed("{\"a\":\n [1,", 10));
+    CHECK(!parser.feed("}", 1));
+    CHECK(parser.error_line() == 2 && parser.error_column() == 5 && parser.error_offset() == 10);
+    CHECK(parser.finish() == nullptr);
+
+    parser.reset();
+    CHECK(parser.feed("[1", 2) && parser.finish() == nullptr);
+
+    // a BOM cut short is invalid, as in JsonDocument::parse
+    parser.reset();
+    CHECK(parser.feed("\xEF", 1) && !parser.feed("\xBB{}", 3) && parser.error() == easy_json::JSON_ERROR_SYNTAX);
+    CHECK(!doc.parse("\xEF\xBB{}"));
+    parser.reset();
+    CHECK(parser.feed("\xEF\xBB", 2) && parser.feed("\xBF{}", 3) && parser.finish() != nullptr);
+
+    // both readers decode escapes alike, lone surrogates are invalid
+    const char * escapes[] = { R"(["\ud83d\ude00"])", R"(["\udc00"])", R"(["\ud83d"])", R"(["\ud83d\u0041"])", R"(["\ud83dx"])", R"(["\u00G0"])" };
+    for (size_t i = 0; i < sizeof(escapes) / sizeof(escapes[0]); ++i)
+    {
+        std::string input = escapes[i];
+        auto * json = easy_json::JsonAny::parse(input.c_str());
+        CHECK((json != nullptr) == (i == 0));
+        delete json;
+
+        parser.reset();
+        bool ok = true;
+        for (char c : input)
+            ok = ok && parser.feed(&c, 1);
+        CHECK((ok && parser.finish() != nullptr) == (i == 0));
+    }
+}
+
+static void test_parse_file()
+{
+    const char text[] = R"({"name":"file","values":[1,2,3]})";
+    const char * path = "easy_json_test_file.json";
+
+    FILE * file = fopen(path, "wb");
+    CHECK(file != nullptr);
+    if (file == nullptr)
+        return;
+    fwrite(text, 1, sizeof(text) - 1, file);
+    fclose(file);
+
+    auto * json = easy_json::JsonAny::parse_file(path);
+    CHECK(json != nullptr && json->dump() == text);
+    delete json;
+
+    easy_json::JsonDocument doc;
+    CHECK(doc.parse_file(path, easy_json::JSON_PARSE_BORROW_INPUT));
+    CHECK(doc.root()->to_object()->get_property("name")->to_str() == "file");
+    CHECK(doc.root()->dump() == text);
+    CHECK(!doc.parse_file("does/not/exist.json") && doc.root() == nullptr);
+    remove(path);
+
+    std::string_view view(text, sizeof(text) - 1);
+    json = easy_json::JsonAny::parse(view.substr(0, view.size() - 1));
+    CHECK(json == nullptr);
+    json = easy_json::JsonAny::parse(view);
+    CHECK(json != nullptr);
+    delete json;
+}
+
+static void test_json_lines()
+{
+    std::string text;
+    for (int i = 0; i < 1000; ++i)
+    {
+        text += "{\"id\":" + std::to_string(i) + ",\"tags\":[\"a\",\"b\"]}";
+        text += i % 7 == 0 ? "\r\n\n" : "\n";
+    }
+    text += "{\"id\":bad}\n[1,2,3]";
+
+    easy_json::JsonLinesParser::Options options;
+    options.threads = 4;
+    options.chunk_size = 1024;
+    easy_json::JsonLinesParser parser(options);
+
+    auto records = parser.parse(text.data(), text.size());
+    CHECK(records.size() == 1002 && parser.failures() == 1);
+    CHECK(parser.lines() == 1000 + 143 + 2);
+    bool ordered = true;
+    for (int i = 0; i < 1000; ++i)
+        ordered = ordered && records[i].ok && records[i].document->root()->to_object()->get_property("id")->to_integer() == i;
+    CHECK(ordered);
+    CHECK(records[1].line == 2 && records[1].offset == text.find("{\"id\":1,"));
+    CHECK(!records[1000].ok && records[1000].line == 1143 && records[1000].error_offset == 6);
+    CHECK(records[1000].error == easy_json::JSON_ERROR_SYNTAX);
+    CHECK(records[1001].ok && records[1001].document->root()->to_array()->count() == 3);
+
+    std::mutex lock;
+    int64_t sum = 0;
+    size_t errors = 0;
+    bool all_ok = parser.parse(text.data(), text.size(), [&](const easy_json::JsonLinesParser::Record &, easy_json::JsonDocument * doc) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (doc == nullptr)
+            ++errors;
+        else if (auto * object = doc->root()->to_object())
+            sum += object->get_property("id")->to_integer();
+    });
+    CHECK(!all_ok && errors == 1 && sum == 999 * 1000 / 2);
+
+    options.threads = 1;
+    easy_json::JsonLinesParser single(options);
+    CHECK(single.parse(text.data(), text.size()).size() == 1002);
+    CHECK(single.parse("", 0).empty() && single.lines() == 0);
+}
+
+static void test_structural_index()
+{
+    std::string pretty = "\xEF\xBB\xBF{\n";
+    for (int i = 0; i < 40; ++i)
+    {
+        pretty += "  \"key" + std::to_string(i) + "\" : [ " + std::to_string(i * 1.5) + " , true, null ,\t\"a\\\"b\\\\\" ,\r\n";
+        pretty += std::string(i % 9, ' ') + "{ \"" + std::string(i, '\\') + std::string(i, '\\') + "\\u00e9\": -12e-3 } ],\n";
+    }
+    pretty += "  \"last\" : { }\n}  \r\n";
+
+    const char * invalid[] = {
+        "[1 2]", "[12a]", "{\"a\" 1}", "[\"abc]", "[tru]", "[true false]", "{\"a\":1,}", "[1,]", "  ", "[\"\\\"]", "[1]", "[1] x",
+    };
+
+    easy_json::JsonDocument expected;
+    CHECK(expected.parse(pretty));
+    std::string dump = expected.root()->dump();
+
+    std::string original = easy_json::structural_index_impl();
+    for (const char * impl : { "avx2", "sse2", "neon", "scalar" })
+    {
+        if (!easy_json::select_structural_index_impl(impl))
+            continue;
+        easy_json::JsonDocument doc;
+        CHECK(doc.parse(pretty, easy_json::JSON_PARSE_STRUCTURAL_INDEX));
+        CHECK(doc.root() != nullptr && doc.root()->dump() == dump);
+        for (const char * text : invalid)
+            CHECK(doc.parse(std::string_view(text), easy_json::JSON_PARSE_STRUCTURAL_INDEX) == expected.parse(text));
+    }
+    CHECK(!easy_json::select_structural_index_impl("none"));
+    CHECK(easy_json::select_structural_index_impl(original.c_str()));
+    CHECK(!expected.parse("{\"a\":1} x") && expected.error() == easy_json::JSON_ERROR_SYNTAX && expected.error_offset() == 8);
+    auto * blank_tail = easy_json::JsonAny::parse("[1] \n");
+    CHECK(easy_json::JsonAny::parse("[1] x") == nullptr && blank_tail != nullptr);
+    delete blank_tail;
+
+    uint32_t positions[easy_json::JsonStructuralIndexer::MIN_CAPACITY];
+    const char text[] = R"({"a\"]":[1, tru]})";
+    easy_json::JsonStructuralIndexer indexer(text, sizeof(text) - 1);
+    size_t count = indexer.next(positions, easy_json::JsonStructuralIndexer::MIN_CAPACITY);
+    CHECK(count == 9 && positions[1] == 1 && positions[2] == 7 && positions[6] == 12 && positions[8] == 16);
+    CHECK(indexer.done() && indexer.next(positions, easy_json::JsonStructuralIndexer::MIN_CAPACITY) == 0);
+}
+
+static void test_lazy_document()
+{
+    std::string text = R"({"skip":{"deep":[1,{"x":"]}\"["}],"s":"}"},"name":"lazy","esc\u00e9":"a\nb",)";
+    text += R"("list":[10, -2.5, true, null, [ ] , {"k" : 18446744073709551615}],"n":-7})";
+
+    easy_json::JsonLazyDocument doc;
+    CHECK(doc.open(text));
+    auto root = doc.root();
+    CHECK(root.is_object());
+    CHECK(root.get_property("name").to_str() == "lazy");
+    CHECK(root.get_property("esc\xC3\xA9").str_view() == "a\nb");
+
+    auto list = root.get_property("list");
+    CHECK(list.is_array() && list.at(0).to_integer() == 10);
+    CHECK(list.at(5).get_property("k").to_unsigned() == UINT64_MAX);
+    CHECK(list.at(1).to_number() == -2.5 && list.at(2).to_boolean() && list.at(3).is_null());
+    CHECK(list.at(4).is_array() && list.at(4).count() == 0 && list.at(4).raw() == "[ ]");
+    CHECK(!list.at(6).valid() && list.count() == 6);
+    CHECK(root.get_property("n").to_integer() == -7);
+    CHECK(!root.get_property("missing").valid() && root.count() == 5);
+
+    // revisited paths come from the cache, skipped subtrees are still reachable
+    CHECK(root.get_property("skip").get_property("deep").at(1).get_property("x").to_str() == "]}\"[");
+    CHECK(root.get_property("skip").get_property("s").to_str() == "}");
+    CHECK(root.get_property("skip").raw() == R"({"deep":[1,{"x":"]}\"["}],"s":"}"})");
+    CHECK(!doc.failed());
+
+    easy_json::JsonDocument full;
+    CHECK(full.parse(list.raw()) && full.root()->to_array()->count() == 6);
+
+    CHECK(doc.open(R"({"a":1,"b":[1,2)"));
+    CHECK(doc.root().get_property("a").to_integer() == 1);
+    CHECK(!doc.root().get_property("c").valid() && doc.failed());
+    CHECK(!doc.open("  7") && !doc.root().valid());
+}
+
+static void test_json_path()
+{
+    const char text[] = R"({"a":{"b":[10,{"c":"deep"}],"x/y":1,"m~n":2,"0":3},"list":[[1,2],[3,4]],"k.e'y":true})";
+
+    easy_json::JsonPath path;
+    CHECK(path.compile_pointer("/a/b/1/c") && path.size() == 4);
+    CHECK(!path.compile_pointer("a/b") && !path.compile_pointer("/a~2"));
+    CHECK(path.compile("$.a.b[0]") && path.size() == 3);
+    CHECK(path.compile("$['k.e\\'y']") && path.size() == 1);
+    CHECK(!path.compile("a.b") && !path.compile("$.a[x]") && !path.compile("$.a[01]") && !path.compile("$['a'"));
+    CHECK(!path.compile("$['abc") && !path.compile("$.") && !path.compile("$.a.") && path.size() == 0);
+
+    easy_json::JsonDocument doc;
+    CHECK(doc.parse(text));
+    easy_json::JsonLazyDocument lazy;
+    CHECK(lazy.open(text));
+
+    const char * pointers[] = { "/a/b/1/c", "/a/x~1y", "/a/m~0n", "/a/0", "/list/1/0", "", "/a/b/2", "/list/x", "/a/b/1/c/d" };
+    easy_json::JsonPathSet set;
+    for (const char * pointer : pointers)
+    {
+        CHECK(path.compile_pointer(pointer));
+        set.add(path);
+    }
+    CHECK(path.compile("$['k.e\\'y']"));
+    size_t key_id = set.add(path);
+    CHECK(path.compile("$.list[0][1]"));
+    size_t list_id = set.add(path);
+    CHECK(set.size() == 11);
+
+    std::vector<easy_json::JsonAny *> found;
+    set.find(doc.root(), found);
+    CHECK(found.size() == 11 && found[0]->to_str() == "deep" && found[1]->to_integer() == 1);
+    CHECK(found[2]->to_integer() == 2 && found[3]->to_integer() == 3 && found[4]->to_integer() == 3);
+    CHECK(found[5] == doc.root() && found[6] == nullptr && found[7] == nullptr && found[8] == nullptr);
+    CHECK(found[key_id]->to_boolean() && found[list_id]->to_integer() == 2);
+
+    std::vector<easy_json::JsonLazyValue> lazy_found;
+    set.find(lazy.root(), lazy_found);
+    CHECK(lazy_found.size() == 11 && lazy_found[0].to_str() == "deep" && lazy_found[4].to_integer() == 3);
+    CHECK(!lazy_found[6].valid() && !lazy_found[8].valid() && lazy_found[key_id].to_boolean());
+    CHECK(lazy_found[list_id].to_integer() == 2 && !lazy.failed());
+
+    CHECK(path.compile_pointer("/a/b/1/c") && path.find(doc.root())->to_str() == "deep");
+    CHECK(path.find(lazy.root()).to_str() == "deep");
+    CHECK(path.find(nullptr) == nullptr);
+
+    // duplicate keys resolve to the last one on text and tree alike
+    const char dup[] = R"({"k":1,"o":{"k":[2]},"k":{"k":3}})";
+    CHECK(doc.parse(dup) && lazy.open(dup) && path.compile("$.k.k"));
+    CHECK(path.find(doc.root())->to_integer() == 3 && path.find(lazy.root()).to_integer() == 3);
+}
+
+namespace bind_test
+{
+    enum class Role
+    {
+        Admin,
+        Guest,
+    };
+    EASY_JSON_BIND_ENUM(Role, Admin, Guest)
+
+    enum Level
+    {
+        Low = 1,
+        High = 9,
+    };
+
+    struct Address
+    {
+        std::string city;
+        int zip = 0;
+    };
+    EASY_JSON_BIND(Address, city, zip)
+
+    struct User
+    {
+        int64_t id = 0;
+        std::string name;
+        bool active = false;
+        double score = 0;
+        uint8_t age = 0;
+        Role role = Role::Guest;
+        Level level = Low;
+        std::optional<std::string> nick;
+        std::optional<int> missing;
+        std::vector<Address> addresses;
+        std::map<std::string, std::vector<int>> tags;
+    };
+    EASY_JSON_BIND(User, id, name, active, score, age, role, level, nick, missing, addresses, tags)
+} // namespace bind_test
+
+static void test_bind()
+{
+    using namespace bind_test;
+    const char text[] = R"({"id":-42,"name":"b\u00e9n","unknown":{"x":[1,{"y":null}]},"active":true,"score":2,
+        "age":200,"role":"Admin","level":9,"nick":null,"addresses":[{"city":"Paris","zip":75001},{"city":"Oslo"}],
+        "tags":{"a":[1,2],"b":[]}})";
+
+    User user;
+    user.nick = "old";
+    CHECK(easy_json::from_json(text, user));
+    CHECK(user.id == -42 && user.name == "b\xC3\xA9n" && user.active && user.score == 2.0 && user.age == 200);
+    CHECK(user.role == Role::Admin && user.level == High && !user.nick && !user.missing);
+    CHECK(user.addresses.size() == 2 && user.addresses[0].zip == 75001 && user.addresses[1].city == "Oslo");
+    CHECK(user.tags.size() == 2 && user.tags["a"].size() == 2 && user.tags["b"].empty());
+
+    std::string out = easy_json::to_json(user);
+    CHECK(out == std::string(R"({"id":-42,"name":"b)") + "\xC3\xA9" + R"(n","active":true,"score":2,"age":200,"role":"Admin","level":9,)"
+                 R"("addresses":[{"city":"Paris","zip":75001},{"city":"Oslo","zip":0}],"tags":{"a":[1,2],"b":[]}})");
+
+    User copy;
+    CHECK(easy_json::from_json(out, copy) && copy.name == user.name && copy.tags == user.tags && copy.role == user.role);
+
+    CHECK(!easy_json::from_json(R"({"age":300})", copy));
+    CHECK(!easy_json::from_json(R"({"id":1.5})", copy));
+    CHECK(!easy_json::from_json(R"({"role":"Owner"})", copy));
+    CHECK(!easy_json::from_json(R"({"name":"x",})", copy));
+    CHECK(!easy_json::from_json(R"({"age":3} trailing)", copy));
+    CHECK(easy_json::from_json(R"({"junk":[{"a":[1,{}]},[]],"age":3} )", copy) && copy.age == 3);
+    std::string deep = R"({"junk":)" + std::string(500000, '[') + std::string(500000, ']') + R"(,"age":3})";
+    CHECK(!easy_json::from_json(deep, copy));
+    std::string nested = R"({"junk":)" + std::string(1000, '[') + std::string(1000, ']') + R"(,"age":4})";
+    CHECK(easy_json::from_json(nested, copy) && copy.age == 4);
+
+    std::vector<int> numbers;
+    CHECK(easy_json::from_json("[1, 2, 3]", numbers) && numbers.size() == 3 && easy_json::to_json(numbers) == "[1,2,3]");
+}
+
+static void test_msgpack()
+{
+    const char text[] = R"({"s":"abc","i":-40,"u":18446744073709551615,"d":0.5,"b":[true,false,null],"o":{"k":300,"n":-70000}})";
+
+    easy_json::JsonDocument doc;
+    CHECK(doc.parse(text));
+    std::string packed = doc.root()->dump_msgpack();
+    CHECK(packed.size() < strlen(text));
+    CHECK(packed.compare(0, 5, "\x86\xA1s\xA3" "a") == 0);
+
+    easy_json::JsonDocument back;
+    CHECK(back.parse_msgpack(packed.data(), packed.size(), easy_json::JSON_PARSE_BORROW_INPUT));
+    CHECK(back.root()->dump() == doc.root()->dump());
+    CHECK(back.root()->to_object()->get_property("u")->number_type() == easy_json::JsonNumberType::Uint64);
+
+    easy_json::JsonAny * heap = easy_json::JsonAny::parse_msgpack(packed.data(), packed.size());
+    CHECK(heap != nullptr && heap->dump() == doc.root()->dump());
+    easy_json::JsonAny::destroy(heap);
+
+    // long strings and containers take the 16 / 32 bit length forms
+    easy_json::JsonDocument big;
+    CHECK(big.parse(std::string_view(R"({"raw":123456789012345678901234567890})"), easy_json::JSON_PARSE_RAW_NUMBERS));
+    auto * list = big.array();
+    for (int i = 0; i < 70000; ++i)
+        list->add(big.integer(i));
+    big.root()->to_object()->set_property("list", list);
+    big.root()->to_object()->set_property("long", big.str(std::string(300, 'x').c_str()));
+    packed = big.root()->dump_msgpack();
+    CHECK(back.parse_msgpack(packed.data(), packed.size()));
+    CHECK(back.root()->to_object()->get_property("list")->to_array()->count() == 70000);
+    CHECK(back.root()->to_object()->get_property("long")->str_view().size() == 300);
+    CHECK(back.root()->to_object()->get_property("raw")->to_number() == 123456789012345678901234567890.0);
+
+    // in place reads
+    packed = doc.root()->dump_msgpack();
+    easy_json::JsonMsgPackValue root(packed.data(), packed.size());
+    CHECK(root.is_object() && root.count() == 6);
+    CHECK(root.get_property("s").str_view() == "abc");
+    CHECK(root.get_property("i").to_integer() == -40 && root.get_property("u").to_unsigned() == UINT64_MAX);
+    CHECK(root.get_property("d").to_number() == 0.5);
+    CHECK(root.get_property("b").at(0).to_boolean() && root.get_property("b").at(2).is_null());
+    CHECK(!root.get_property("b").at(3).valid() && !root.get_property("missing").valid());
+    CHECK(root.get_property("o").get_property("n").to_integer() == -70000);
+    CHECK(root.get_property("o").raw().size() == 13 && root.raw().size() == packed.size());
+
+    // truncated input, non string keys and binary values are rejected
+    for (size_t n = 0; n < packed.size(); ++n)
+        CHECK(!back.parse_msgpack(packed.data(), n));
+    CHECK(!easy_json::JsonMsgPackValue(packed.data(), packed.size() - 1).get_property("o").get_property("n").valid());
+    CHECK(!back.parse_msgpack("\x81\x01\x02", 3) && !back.parse_msgpack("\xC4\x01" "a", 3));
+    CHECK(back.parse_msgpack("\xCA\x3F\xC0\x00\x00", 5) && back.root()->to_number() == 1.5);
+}
+
+static void test_stats()
+{
+    struct Seen
+    {
+        easy_json::JsonParseStats parse;
+        easy_json::JsonWriteStats write;
+        int parses = 0;
+        int writes = 0;
+    } seen;
+
+    easy_json::JsonStatsHooks hooks;
+    hooks.on_parse = [](const easy_json::JsonParseStats & stats, void * user) {
+        static_cast<Seen *>(user)->parse = stats;
+        ++static_cast<Seen *>(user)->parses;
+    };
+    hooks.on_write = [](const easy_json::JsonWriteStats & stats, void * user) {
+        static_cast<Seen *>(user)->write = stats;
+        ++static_cast<Seen *>(user)->writes;
+    };
+    hooks.user = &seen;
+    easy_json::set_stats_hooks(&hooks);
+    CHECK(easy_json::stats_hooks() == &hooks);
+
+    const char text[] = R"({"a":[1,2.5,{"b":[[]]}],"s":"x\ny\u00e9","t":true,"f":false,"n":null})";
+    easy_json::JsonDocument doc;
+    CHECK(doc.parse(text));
+    std::string out = doc.root()->dump();
+    CHECK(!doc.parse(text, 5));
+
+#if EASY_JSON_STATS
+    CHECK(seen.parses == 2 && seen.writes == 1);
+    CHECK(!seen.parse.ok);
+    CHECK(doc.parse(text) && seen.parse.ok);
+    CHECK(seen.parse.bytes == strlen(text));
+    CHECK(seen.parse.objects == 2 && seen.parse.arrays == 3 && seen.parse.keys == 6);
+    CHECK(seen.parse.numbers == 2 && seen.parse.strings == 1 && seen.parse.booleans == 2 && seen.parse.nulls == 1);
+    CHECK(seen.parse.max_depth == 5 && seen.parse.escapes == 2);
+    // the reparse runs in the block kept from the first one
+    CHECK(seen.parse.allocations == 0 && seen.parse.bytes_allocated == 0);
+    easy_json::JsonDocument fresh;
+    CHECK(fresh.parse(text) && seen.parse.allocations >= 1 && seen.parse.bytes_allocated >= seen.parse.allocations);
+    CHECK(seen.write.bytes == out.size() && seen.write.values == 11 && seen.write.escapes == 1);
+
+    easy_json::JsonAny::destroy(easy_json::JsonAny::parse(text));
+    CHECK(seen.parses == 5 && seen.parse.ok && seen.parse.allocations == 0);
+#else
+    CHECK(seen.parses == 0 && seen.writes == 0);
+#endif
+
+    easy_json::set_stats_hooks(nullptr);
+    CHECK(doc.parse(text) && easy_json::stats_hooks() == nullptr);
+}
+
+struct StopHandler : easy_json::JsonBaseHandler
+{
+    bool on_number(const easy_json::JsonNumberValue &, std::string_view) { return false; }
+};
+
+static void test_parse_limits()
+{
+    // nesting far beyond the native stack fails cleanly
+    std::string deep(1000000, '[');
+    easy_json::JsonDocument doc;
+    CHECK(!doc.parse(deep) && doc.error() == easy_json::JSON_ERROR_DEPTH && doc.error_offset() == 1024);
+    CHECK(easy_json::JsonAny::parse(deep) == nullptr);
+
+    std::string nested = std::string(1024, '[') + std::string(1024, ']');
+    CHECK(doc.parse(nested) && doc.error() == easy_json::JSON_ERROR_NONE);
+    CHECK(!doc.parse("[" + nested + "]") && doc.error() == easy_json::JSON_ERROR_DEPTH);
+
+    easy_json::JsonParseLimits limits;
+    limits.max_depth = 2;
+    limits.max_string_length = 3;
+    limits.max_nodes = 6;
+    doc.set_limits(limits);
+    CHECK(doc.parse(R"({"abc":[1,"xyz"],"d":{}})"));
+    CHECK(!doc.parse(R"({"a":[[1]]})") && doc.error() == easy_json::JSON_ERROR_DEPTH);
+    CHECK(!doc.parse(R"(["abcd"])") && doc.error() == easy_json::JSON_ERROR_STRING_LENGTH);
+    CHECK(!doc.parse(R"(["ab\nc"])") && doc.error() == easy_json::JSON_ERROR_STRING_LENGTH);
+    CHECK(!doc.parse(R"({"long":1})") && doc.error() == easy_json::JSON_ERROR_STRING_LENGTH);
+    CHECK(!doc.parse("[1,2,3,4,5,6]") && doc.error() == easy_json::JSON_ERROR_NODE_COUNT);
+    limits.max_document_size = 8;
+    doc.set_limits(limits);
+    CHECK(!doc.parse("[1, 2, 3]") && doc.error() == easy_json::JSON_ERROR_DOCUMENT_SIZE && doc.error_offset() == 0);
+    CHECK(doc.parse("[1,2,3]") && doc.root()->to_array()->count() == 3);
+    CHECK(!doc.parse("[1,2,]") && doc.error() == easy_json::JSON_ERROR_SYNTAX && doc.error_offset() == 5);
+
+    // the push parser takes the limits of its document
+    easy_json::JsonPushParser push(doc);
+    CHECK(push.feed("[1,2") && push.feed(",3]") && push.finish() != nullptr);
+    push.reset();
+    CHECK(push.feed("[1,") && !push.feed(" 2, 3]") && push.error() == easy_json::JSON_ERROR_DOCUMENT_SIZE);
+    limits.max_document_size = SIZE_MAX;
+    doc.set_limits(limits);
+    push.reset();
+    CHECK(!push.feed(R"({"a":[[1]]})") && push.error() == easy_json::JSON_ERROR_DEPTH && push.error_offset() == 6);
+    push.reset();
+    CHECK(push.feed(R"(["ab)") && !push.feed(R"(\u00e9"])") && push.error() == easy_json::JSON_ERROR_STRING_LENGTH);
+    push.reset();
+    CHECK(!push.feed("[1,2,3,4,5,6]") && push.error() == easy_json::JSON_ERROR_NODE_COUNT && push.finish() == nullptr);
+    doc.set_limits(easy_json::JsonParseLimits());
+    push.reset();
+    std::string brackets = std::string(300000, '[') + std::string(300000, ']');
+    CHECK(!push.feed(brackets) && push.error() == easy_json::JSON_ERROR_DEPTH && push.error_offset() == 1024);
+    CHECK(push.finish() == nullptr && strcmp(push.error_message(), "nesting too deep") == 0);
+
+    doc.set_limits(easy_json::JsonParseLimits());
+    std::string packed(2000, '\x91');
+    packed.push_back('\x01');
+    CHECK(!doc.parse_msgpack(packed.data(), packed.size()) && doc.error() == easy_json::JSON_ERROR_DEPTH);
+    CHECK(!doc.parse_file("/nonexistent/easy_json.json") && doc.error() == easy_json::JSON_ERROR_FILE);
+
+    StopHandler stop;
+    easy_json::JsonReader<StopHandler> reader("[[],{},1]", 9);
+    CHECK(!reader.parse(stop) && reader.error() == easy_json::JSON_ERROR_HANDLER && reader.offset() == 8);
+    CHECK(strcmp(easy_json::json_error_message(easy_json::JSON_ERROR_DEPTH), "nesting too deep") == 0);
+}
+
+static std::string routing_config(int version)
+{
+    std::string text = R"({"version":)" + std::to_string(version) + R"(,"routes":{)";
+    for (int i = 0; i < 40; ++i)
+        text += (i ? "," : "") + std::string("\"r") + std::to_string(i) + "\":{\"host\":\"h" + std::to_string(i) + "\"}";
+    return text + R"(},"limits":[1,2,3]})";
+}
+
+static void test_shared_document()
+{
+    auto first = std::make_shared<easy_json::JsonDocument>();
+    CHECK(first->parse(routing_config(1)));
+    easy_json::JsonSharedDocument current(first);
+    CHECK(first->frozen());
+
+    // frozen documents ignore changes
+    auto * routes = first->root()->to_object()->get_property("routes")->to_object();
+    routes->set_property("r0", first->null());
+    first->root()->to_object()->get_property("limits")->to_array()->add(first->integer(4));
+    first->set_root(nullptr);
+    CHECK(first->root() != nullptr && first->root()->to_object()->get_property("limits")->to_array()->count() == 3);
+
+    std::atomic<bool> stop(false);
+    std::atomic<int> errors(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t)
+    {
+        readers.emplace_back([&] {
+            while (!stop.load())
+            {
+                auto snapshot = current.load();
+                auto * all = snapshot->root()->to_object()->get_property("routes")->to_object();
+                for (int i = 0; i < 40; ++i)
+                {
+                    auto * route = all->get_property("r" + std::to_string(i));
+                    if (route == nullptr || route->to_object()->get_property("host")->to_str() != "h" + std::to_string(i))
+                        ++errors;
+                }
+            }
+        });
+    }
+
+    // reloads reuse unchanged subtrees of the previous version
+    std::weak_ptr<const easy_json::JsonDocument> oldest = current.load();
+    std::weak_ptr<const easy_json::JsonDocument> second;
+    for (int version = 2; version <= 20; ++version)
+    {
+        auto previous = current.load();
+        auto next = std::make_shared<easy_json::JsonDocument>();
+        CHECK(next->parse(routing_config(version)));
+        auto * root = next->root()->to_object();
+        for (size_t i = 0; i < root->count(); ++i)
+        {
+            std::string_view key = root->key_view_at(static_cast<int>(i));
+            auto * old_value = previous->root()->to_object()->get_property(key);
+            if (old_value != nullptr && old_value->equals(root->value_at(static_cast<int>(i))))
+                root->set_property(key, next->share(previous, old_value));
+        }
+        CHECK(root->get_property("routes") == routes && root->get_property("version")->to_integer() == version);
+        current.store(next);
+        if (version == 2)
+            second = current.load();
+    }
+
+    stop = true;
+    for (auto & reader : readers)
+        reader.join();
+    CHECK(errors == 0);
+    CHECK(second.expired() && routes->get_property("r0")->is_object());
+
+    // the first version lives on through the subtree every later one shares
+    first.reset();
+    CHECK(!oldest.expired());
+    auto last = current.exchange(nullptr);
+    CHECK(!current.load() && last.use_count() == 1);
+    last.reset();
+    CHECK(oldest.expired());
+
+    easy_json::JsonDocument a, b;
+    CHECK(a.parse(R"({"x":[1,2.0,"s",null],"y":{"k":true}})") && b.parse(R"({"y":{"k":true},"x":[1,2,"s",null]})"));
+    CHECK(a.root()->equals(b.root()));
+    CHECK(b.parse(R"({"y":{"k":true},"x":[1,2,"s"]})") && !a.root()->equals(b.root()));
+    CHECK(b.parse("[18446744073709551615]") && a.parse("[-1]") && !a.root()->equals(b.root()));
+    CHECK(a.share(std::make_shared<easy_json::JsonDocument>(), b.root()) == nullptr);
+}
+
+static void test_document_reuse()
+{
+    std::string text = "[";
+    for (int i = 0; i < 2000; ++i)
+        text += std::string(i ? "," : "") + R"({"id":)" + std::to_string(i) + R"(,"name":"item\n)" + std::to_string(i) + R"(","tags":[1,2,{"deep":[true]}]})";
+    text += "]";
+
+    easy_json::JsonDocument doc;
+    CHECK(doc.parse(text) && doc.arena().allocations() > 1);
+    // the second parse runs in the merged block, then nothing grows
+    CHECK(doc.parse(text, easy_json::JSON_PARSE_STRUCTURAL_INDEX));
+    size_t allocations = doc.allocations();
+    size_t reserved = doc.arena().bytes_reserved();
+    for (int i = 0; i < 5; ++i)
+    {
+        CHECK(doc.parse(text, easy_json::JSON_PARSE_STRUCTURAL_INDEX));
+        CHECK(doc.parse(text));
+        CHECK(doc.root()->to_array()->at(1999)->to_object()->get_property("name")->str_view() == "item\n1999");
+    }
+    CHECK(doc.allocations() == allocations && doc.arena().bytes_reserved() == reserved);
+
+    // a failed parse or a reset keeps the memory, clear() gives it back
+    CHECK(!doc.parse(text.substr(0, text.size() - 1)) && doc.root() == nullptr);
+    CHECK(doc.arena().bytes_reserved() == reserved);
+    doc.reset();
+    CHECK(doc.root() == nullptr && doc.arena().bytes_used() == 0 && doc.arena().bytes_reserved() == reserved);
+    std::string buffer = text;
+    CHECK(doc.parse_in_situ(&buffer[0], buffer.size()) && doc.root()->to_array()->count() == 2000);
+    CHECK(doc.allocations() == allocations);
+
+    // heap nodes attached to the tree are released by reset()
+    doc.set_root(easy_json::JsonAny::parse("[1,2]"));
+    doc.reset();
+    CHECK(doc.root() == nullptr && doc.allocations() == allocations);
+    doc.clear();
+    CHECK(doc.arena().bytes_reserved() == 0);
+}
+
+static void test_interned_keys()
+{
+    std::string text = "[";
+    for (int i = 0; i < 500; ++i)
+        text += std::string(i ? "," : "") + R"({"id":)" + std::to_string(i) + R"(,"timestamp":)" + std::to_string(i * 10) +
+                R"(,"user\u0041":"u)" + std::to_string(i) + "\"}";
+    text += "]";
+
+    easy_json::JsonDocument plain;
+    CHECK(plain.parse(text));
+    easy_json::JsonDocument doc;
+    doc.set_intern_keys(true);
+    CHECK(doc.parse(text) && doc.interned_keys() == 3);
+    CHECK(doc.arena().bytes_used() < plain.arena().bytes_used());
+    CHECK(doc.root()->equals(plain.root()));
+
+    // every record shares the stored keys
+    auto * first = doc.root()->to_array()->at(0)->to_object();
+    auto * last = doc.root()->to_array()->at(499)->to_object();
+    CHECK(first->key_view_at(2).data() == last->key_view_at(2).data() && last->key_view_at(2) == "userA");
+
+    easy_json::JsonKey ts = doc.find_key("timestamp");
+    CHECK(ts.valid() && ts.document() == &doc && ts.view() == "timestamp");
+    CHECK(last->get_property(ts)->to_integer() == 4990);
+    CHECK(!doc.find_key("missing").valid() && last->get_property(doc.find_key("missing")) == nullptr);
+    // set_property interns too, keys of other documents compare strings
+    last->set_property("extra", doc.integer(1))->set_property("id", doc.integer(-1));
+    CHECK(doc.interned_keys() == 4 && last->get_property(doc.find_key("extra"))->to_integer() == 1);
+    CHECK(last->get_property("id")->to_integer() == -1 && last->count() == 4);
+    CHECK(plain.root()->to_array()->at(3)->to_object()->get_property(ts)->to_integer() == 30);
+
+    // borrowed keys are not copied, the table empties with the tree
+    std::string input = R"({"alpha":1,"beta":{"alpha":2}})";
+    CHECK(doc.parse(input, easy_json::JSON_PARSE_BORROW_INPUT) && doc.interned_keys() == 2);
+    easy_json::JsonKey alpha = doc.find_key("alpha");
+    CHECK(alpha.view().data() >= input.data() && alpha.view().data() < input.data() + input.size());
+    CHECK(doc.root()->to_object()->get_property("beta")->to_object()->get_property(alpha)->to_integer() == 2);
+    doc.freeze();
+    CHECK(!doc.intern_key("gamma").valid() && doc.intern_key("beta").valid() && doc.interned_keys() == 2);
+    doc.reset();
+    CHECK(doc.interned_keys() == 0 && !doc.find_key("alpha").valid());
+}
+
+static void test_packed_arrays()
+{
+    std::string text = R"({"coords":[)";
+    for (int i = 0; i < 1000; ++i)
+        text += std::string(i ? "," : "") + std::to_string(i) + ".5";
+    text += R"(],"ids":[1,-2,3],"mixed":[1,2.5],"empty":[],"pairs":[[1.5,2.5],[3,4]],"rows":[)";
+    for (int i = 0; i < 100; ++i)
+        text += std::string(i ? "," : "") + R"({"x":)" + std::to_string(i) + R"(,"y":)" + std::to_string(i) + R"(.25,"name":"p"})";
+    text += "]}";
+
+    easy_json::JsonDocument doc;
+    CHECK(doc.parse(text));
+    auto * root = doc.root()->to_object();
+    auto * coords = root->get_property("coords")->to_array();
+    CHECK(coords->packed() && coords->count() == 1000);
+    easy_json::JsonColumn column = coords->column();
+    CHECK(column.size == 1000 && column.doubles() && !column.integers() && column.doubles()[999] == 999.5);
+    // elements read as nodes, stored side by side
+    CHECK(coords->at(10)->to_number() == 10.5 && coords->at(11) == coords->at(10) + 1 && coords->at(1000) == nullptr);
+
+    auto * ids = root->get_property("ids")->to_array();
+    CHECK(ids->packed() && ids->column().integers()[1] == -2 && ids->at(2)->number_type() == easy_json::JsonNumberType::Int64);
+    CHECK(!root->get_property("mixed")->to_array()->packed() && root->get_property("mixed")->to_array()->at(1)->to_number() == 2.5);
+    CHECK(!root->get_property("empty")->to_array()->packed() && !root->get_property("pairs")->to_array()->packed());
+    CHECK(root->get_property("pairs")->to_array()->at(1)->to_array()->column().integers()[1] == 4);
+    CHECK(root->get_property("ids")->dump() == "[1,-2,3]");
+
+    easy_json::JsonAny * heap = easy_json::JsonAny::parse(text);
+    CHECK(heap->equals(doc.root()) && !heap->to_object()->get_property("coords")->to_array()->packed());
+    CHECK(heap->dump() == doc.root()->dump() && heap->dump_msgpack() == doc.root()->dump_msgpack());
+    easy_json::JsonAny::destroy(heap);
+    CHECK(doc.parse(text, easy_json::JSON_PARSE_RAW_NUMBERS) && !doc.root()->to_object()->get_property("ids")->to_array()->packed());
+
+    // per-field columns of a table array follow changes to its rows
+    CHECK(doc.parse(text));
+    auto * rows = doc.root()->to_object()->get_property("rows")->to_array();
+    CHECK(!rows->packed() && rows->column("x").integers()[99] == 99 && rows->column("y").doubles()[3] == 3.25);
+    CHECK(!rows->column("name").valid() && !rows->column("missing").valid());
+    rows->at(5)->to_object()->set_property("x", doc.number(0.5));
+    CHECK(!rows->column("x").valid() && rows->column("y").size == 100);
+    rows->at(5)->to_object()->set_property("x", doc.integer(-5));
+    CHECK(rows->column("x").integers()[5] == -5);
+    rows->add(doc.object());
+    CHECK(!rows->column("y").valid());
+
+    // add() unpacks, a frozen document builds its forms up front
+    ids = doc.root()->to_object()->get_property("ids")->to_array();
+    ids->add(doc.str("four"));
+    CHECK(!ids->packed() && ids->count() == 4 && ids->dump() == R"([1,-2,3,"four"])");
+    CHECK(doc.parse(text));
+    doc.freeze();
+    rows = doc.root()->to_object()->get_property("rows")->to_array();
+    CHECK(rows->column("y").doubles()[99] == 99.25 && !rows->column("missing").valid());
+    CHECK(doc.root()->to_object()->get_property("coords")->to_array()->at(3)->to_number() == 3.5);
+}
+
+static void test_transcoder()
+{
+    const std::string text = " {\"b\" : [1.50e3, true, null, {}], \"a\":{\"y\":\"\xc3\xa9\xf0\x9f\x98\x80\\n\",\"x\":[]} ,\"b\":-0 } ";
+    auto transcode = [&](const easy_json::JsonTranscodeOptions & options, std::string_view input) {
+        std::string out;
+        easy_json::JsonStringSink sink(out);
+        easy_json::JsonTranscoder transcoder(sink, options);
+        return transcoder.transcode(input) ? out : std::string("failed");
+    };
+
+    // numbers keep their text, duplicate keys stay
+    easy_json::JsonTranscodeOptions options;
+    CHECK(transcode(options, text) == "{\"b\":[1.50e3,true,null,{}],\"a\":{\"y\":\"\xc3\xa9\xf0\x9f\x98\x80\\n\",\"x\":[]},\"b\":-0}");
+    options.escape_unicode = true;
+    options.sort_keys = true;
+    CHECK(transcode(options, text) == R"({"a":{"x":[],"y":"\u00e9\ud83d\ude00\n"},"b":[1.50e3,true,null,{}],"b":-0})");
+    options.indent = 2;
+    options.sort_keys = false;
+    CHECK(transcode(options, R"([1,{"k":[]},{"a":{"b":null}}])") ==
+          "[\n  1,\n  {\n    \"k\": []\n  },\n  {\n    \"a\": {\n      \"b\": null\n    }\n  }\n]");
+    CHECK(transcode(options, "[\"\xff\xc3\"]") == "[\n  \"\\ufffd\\ufffd\"\n]");
+
+    // arrays outside objects stream, each object must fit the sort buffer
+    options = easy_json::JsonTranscodeOptions();
+    options.sort_keys = true;
+    options.sort_buffer = 64;
+    CHECK(transcode(options, R"([{"b":1,"a":2},{"d":[{"z":0,"y":1}],"c":3}])") == R"([{"a":2,"b":1},{"c":3,"d":[{"y":1,"z":0}]}])");
+    CHECK(transcode(options, R"({"key":")" + std::string(100, 'x') + "\"}") == "failed");
+
+    // pieces and streams give the same text, a bad document reports where
+    std::string out;
+    easy_json::JsonStringSink sink(out);
+    easy_json::JsonTranscoder transcoder(sink, options);
+    CHECK(!transcoder.transcode(R"({"key":")" + std::string(100, 'x') + "\"}"));
+    CHECK(strcmp(transcoder.error_message(), "object larger than the sort buffer") == 0 && out.empty());
+    for (char c : std::string(R"({"b":[1,2.5e1],"a":"é"})"))
+        CHECK(transcoder.feed(&c, 1));
+    CHECK(transcoder.finish() && out == "{\"a\":\"\xc3\xa9\",\"b\":[1,2.5e1]}");
+    out.clear();
+    CHECK(!transcoder.transcode(std::string_view("[1,]")) && transcoder.error_message() != nullptr && out.empty());
+
+    FILE * file = tmpfile();
+    std::string big = "[";
+    for (int i = 0; i < 20000; ++i)
+        big += std::string(i ? "," : "") + R"({"v":)" + std::to_string(i) + R"(,"k":"s"})";
+    big += "]";
+    fwrite(big.data(), 1, big.size(), file);
+    rewind(file);
+    CHECK(transcoder.transcode(file) && out.size() == big.size() && out.compare(0, 20, R"([{"k":"s","v":0},{"k)") == 0);
+    fclose(file);
+    CHECK(!transcoder.transcode_file("/nonexistent/easy_json.json"));
+
+    // buffers and fed pieces agree on validity and limits
+    auto fed = [&](std::string_view input) {
+        out.clear();
+        transcoder.reset();
+        return transcoder.feed(input.data(), input.size()) && transcoder.finish();
+    };
+    const char * inputs[] = { "[1] \n", "[1] x", R"(["\udc00"])", R"({"a":[[1]]})" };
+    for (const char * input : inputs)
+        CHECK(fed(input) == transcoder.transcode(std::string_view(input)));
+    CHECK(fed("[1] \n") && !fed("[1] x") && !fed(R"(["\udc00"])"));
+
+    options.limits.max_depth = 2;
+    easy_json::JsonTranscoder shallow(sink, options);
+    CHECK(!shallow.transcode(std::string_view(R"({"a":[[1]]})")) && strcmp(shallow.error_message(), "nesting too deep") == 0);
+    CHECK(!shallow.feed(R"({"a":[[)", 8) && strcmp(shallow.error_message(), "nesting too deep") == 0);
+
+    // deep input fails cleanly, and sorted output never recurses
+    options.limits = easy_json::JsonParseLimits();
+    options.sort_buffer = 16 << 20;
+    easy_json::JsonTranscoder sorted(sink, options);
+    std::string deep = "{\"a\":" + std::string(200000, '[');
+    CHECK(!sorted.feed(deep.data(), deep.size()) && strcmp(sorted.error_message(), "nesting too deep") == 0);
+    options.limits.max_depth = 300000;
+    easy_json::JsonTranscoder nested(sink, options);
+    deep += std::string(200000, ']') + "}";
+    out.clear();
+    CHECK(nested.feed(deep.data(), deep.size()) && nested.finish() && out == deep);
+    out.clear();
+    CHECK(nested.transcode(deep) && out == deep);
+}
 
 int main()
 {
@@ -7,5 +1059,32 @@ int main()
 
     auto * json = easy_json::JsonAny::parse(json_string);
     printf("%p\n", json);
-    return 0;
-}
\ No newline at end of file
+    CHECK(json != nullptr);
+    CHECK(json->to_object()->get_property("arr")->to_array()->count() == 4);
+    delete json;
+
+    test_value();
+    test_document();
+    test_object_index();
+    test_strings();
+    test_borrowed_strings();
+    test_numbers();
+    test_writer();
+    test_sax();
+    test_push_parser();
+    test_parse_file();
+    test_json_lines();
+    test_structural_index();
+    test_lazy_document();
+    test_json_path();
+    test_bind();
+    test_msgpack();
+    test_stats();
+    test_parse_limits();
+    test_shared_document();
+    test_document_reuse();
+    test_interned_keys();
+    test_packed_arrays();
+    test_transcoder();
+    return failures == 0 ? 0 : 1;
+}
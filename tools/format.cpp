@@ -0,0 +1,65 @@
+﻿#include "easy_json_transcode.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Rewrites JSON from stdin or the files given, without building a tree
+namespace
+{
+    void usage()
+    {
+        printf("usage: easy_json_format [--indent N] [--ascii] [--sort] [--sort-buffer BYTES] [FILE...]\n");
+    }
+} // namespace
+
+int main(int argc, char ** argv)
+{
+    easy_json::JsonTranscodeOptions options;
+    int first_file = argc;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--indent") == 0 && i + 1 < argc)
+            options.indent = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--ascii") == 0)
+            options.escape_unicode = true;
+        else if (strcmp(argv[i], "--sort") == 0)
+            options.sort_keys = true;
+        else if (strcmp(argv[i], "--sort-buffer") == 0 && i + 1 < argc)
+            options.sort_buffer = strtoull(argv[++i], nullptr, 10);
+        else if (argv[i][0] == '-' && argv[i][1] != '\0')
+        {
+            usage();
+            return 2;
+        }
+        else
+        {
+            first_file = i;
+            break;
+        }
+    }
+
+    easy_json::JsonFileSink sink(stdout);
+    easy_json::JsonTranscoder transcoder(sink, options);
+    int failures = 0;
+    auto run = [&](const char * name, bool ok) {
+        if (ok)
+            fputc('\n', stdout);
+        else
+        {
+            fprintf(stderr, "easy_json_format: %s: %s at byte %zu\n", name, transcoder.error_message(), transcoder.error_offset());
+            ++failures;
+        }
+    };
+
+    if (first_file == argc)
+        run("<stdin>", transcoder.transcode(stdin));
+    for (int i = first_file; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-") == 0)
+            run("<stdin>", transcoder.transcode(stdin));
+        else
+            run(argv[i], transcoder.transcode_file(argv[i]));
+    }
+    return failures == 0 ? 0 : 1;
+}